@@ -0,0 +1,174 @@
+#include "ModbusBitTable.h"
+#include "ModbusDevice.h"
+#include <cassert>
+#include <iterator>
+
+namespace mb{
+
+    BitTable::BitTable(Device* device_, Table table_):
+        table(table_),
+        device(device_)
+    {
+        assert((table == Table::Coils || table == Table::DiscreteInputs) && "BitTable holds coils or discrete inputs");
+    }
+
+    void BitTable::add(int addr) {
+        std::lock_guard<std::mutex> lk(mtx);
+        addrs.insert(addr);
+        refreshed = false;
+    }
+
+    bool BitTable::dirty(int addr) const {
+        if(!refreshed || std::chrono::steady_clock::now() - time > max_age)
+            return true;
+        // like a register cache, retry failed bits on the next access. Holes never become valid
+        return !test(valid, addr) && !layout.holes().count(addr);
+    }
+
+    bool BitTable::test(const std::vector<uint64_t>& words, int addr) const {
+        const int index = addr - first;
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+
+    void BitTable::assign(std::vector<uint64_t>& words, int addr, bool value) {
+        const int index = addr - first;
+        const uint64_t mask = uint64_t(1) << (index % 64);
+        if(value)
+            words[index / 64] |= mask;
+        else
+            words[index / 64] &= ~mask;
+    }
+
+    bool BitTable::refresh() {
+        std::lock_guard<std::mutex> lk(mtx);
+        return refreshLocked();
+    }
+
+    bool BitTable::refreshLocked() {
+        if(addrs.empty())
+            return true;
+        const int start = *addrs.begin();
+        const size_t words = (*addrs.rbegin() - start) / 64 + 1;
+        if(start != first || bits.size() != words){
+            first = start;
+            bits.assign(words, 0);
+            valid.assign(words, 0);
+        }
+
+        // known holes fail every request covering them, they are never read again
+        std::vector<int> readable;
+        for(int addr : addrs){
+            if(!layout.holes().count(addr))
+                readable.push_back(addr);
+        }
+        bool result = readable.size() == addrs.size();
+        layout.resetErrors();
+        size_t i = 0;
+        while(i < readable.size()){
+            // one request covers all registered bits within MODBUS_MAX_READ_BITS of the first
+            size_t end = i + 1;
+            while(end < readable.size() && readable[end] < readable[i] + MODBUS_MAX_READ_BITS && layout.mergeable(readable[i], readable[end] + 1))
+                end++;
+            result = layout.read(i, end,
+                [&readable](size_t unit){ return std::make_pair(readable[unit], readable[unit] + 1); },
+                [this, &readable](size_t first, size_t last, int& error){ return request(readable, first, last, error); },
+                [this, &readable](size_t first, size_t last){
+                    for(size_t u = first; u < last; u++)
+                        assign(valid, readable[u], false);
+                }) && result;
+            i = end;
+        }
+        time = std::chrono::steady_clock::now();
+        refreshed = true;
+        // an exception response proves the device is reachable
+        device->setOnline(!layout.transportError());
+        return result;
+    }
+
+    bool BitTable::request(const std::vector<int>& readable, size_t firstBit, size_t lastBit, int& error) {
+        const int start = readable[firstBit];
+        const int nb = readable[lastBit - 1] - start + 1;
+        uint8_t buffer[MODBUS_MAX_READ_BITS];
+        int status = -1;
+        {
+            RequestQueue::Ticket ticket(device->modbus_queue, priority);
+            TraceStopwatch<TraceLevel::Debug> stopwatch;
+            if(device->ensureConnected()){
+                if(table == Table::Coils)
+                    status = modbus_read_bits(device->connection, start, nb, buffer);
+                else
+                    status = modbus_read_input_bits(device->connection, start, nb, buffer);
+            }
+            if(status != nb){
+                error = errno;
+                MODBUS_TRACE(TraceLevel::Error, TraceEvent::ReadError, device->trace_source, start, nb, status, error, stopwatch.elapsed());
+                return false;
+            }
+            MODBUS_TRACE(TraceLevel::Debug, TraceEvent::Read, device->trace_source, start, nb, status, 0, stopwatch.elapsed());
+        }
+        for(size_t u = firstBit; u < lastBit; u++){
+            assign(bits, readable[u], buffer[readable[u] - start]);
+            assign(valid, readable[u], true);
+        }
+        return true;
+    }
+
+    bool BitTable::get(int addr, bool force, bool* ret) {
+        std::lock_guard<std::mutex> lk(mtx);
+        assert(addrs.count(addr) && "Bit must be added before reading");
+        if(force || dirty(addr))
+            refreshLocked();
+        const bool result = refreshed && test(valid, addr);
+        if(ret)
+            *ret = result;
+        return result && test(bits, addr);
+    }
+
+    bool BitTable::set(int addr, bool value) {
+        if(table != Table::Coils)
+            return false;
+        int status;
+        {
+            RequestQueue::Ticket ticket(device->modbus_queue, Priority::Control);
+            TraceStopwatch<TraceLevel::Info> stopwatch;
+            status = device->ensureConnected() ? modbus_write_bit(device->connection, addr, value) : -1;
+            if(status == 1)
+                MODBUS_TRACE(TraceLevel::Info, TraceEvent::Write, device->trace_source, addr, 1, status, 0, stopwatch.elapsed());
+            else
+                MODBUS_TRACE(TraceLevel::Error, TraceEvent::WriteError, device->trace_source, addr, 1, status, errno, stopwatch.elapsed());
+        }
+        const bool result = status == 1;
+        std::lock_guard<std::mutex> lk(mtx);
+        if(result && refreshed && addrs.count(addr)){
+            assign(bits, addr, value);
+            assign(valid, addr, true);
+        }
+        return result;
+    }
+
+    Coil::Coil(Device* device_, int addr_):
+        addr(addr_),
+        device(device_)
+    {
+        device->coils.add(addr);
+    }
+
+    bool Coil::getValue(bool force, bool* ret) const {
+        return device->coils.get(addr, force, ret);
+    }
+
+    bool Coil::setValue(bool value) {
+        return device->coils.set(addr, value);
+    }
+
+    DiscreteInput::DiscreteInput(Device* device_, int addr_):
+        addr(addr_),
+        device(device_)
+    {
+        device->discrete_inputs.add(addr);
+    }
+
+    bool DiscreteInput::getValue(bool force, bool* ret) const {
+        return device->discrete_inputs.get(addr, force, ret);
+    }
+}
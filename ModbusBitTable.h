@@ -0,0 +1,193 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "ModbusLearnedLayout.h"
+#include "ModbusRequestQueue.h"
+#include "ModbusTable.h"
+
+namespace mb{
+
+    class Device;
+
+    /**
+     * @brief Packed image of the coils or discrete inputs of a #mb::Device
+     *
+     * Bits are registered by #mb::Coil and #mb::DiscreteInput. A refresh reads
+     * all registered bits with as few requests as possible, each covering up
+     * to MODBUS_MAX_READ_BITS (2000) bits, and stores them packed into 64 bit
+     * words. Validity is tracked per bit, a failed request only invalidates
+     * the bits it covers and failed bits are read again on their next access.
+     * A request answered with ILLEGAL DATA ADDRESS is split until the unmapped
+     * addresses or block boundaries are found, they are remembered and never
+     * read across again (see #mb::LearnedLayout).
+     */
+    class BitTable
+    {
+        public:
+            /**
+             * @brief Construct a new Bit Table object
+             *
+             * @param device_ #mb::Device instance the bits belong to
+             * @param table_ #mb::Table::Coils or #mb::Table::DiscreteInputs
+             */
+            BitTable(Device* device_, Table table_);
+            BitTable(const BitTable& other) = delete;
+            virtual ~BitTable() = default;
+
+            /**
+             * @brief Table of the bits
+             *
+             */
+            const Table table;
+            /**
+             * @brief Maximum age of the image before it is read again
+             *
+             */
+            std::chrono::duration<float, std::milli> max_age{3000};
+            /**
+             * @brief Priority class used when reading the bits
+             *
+             */
+            Priority priority{Priority::Telemetry};
+
+            /**
+             * @brief Register a bit to be read
+             *
+             * @param addr Address of the bit
+             */
+            void add(int addr);
+            /**
+             * @brief Get a bit, refreshing the whole image if it is outdated
+             *
+             * @param addr Address of the bit
+             * @param force Refresh even if the image is recent
+             * @param ret Return status (true: success, false: fail)
+             * @return bool Value of the bit, false on failure
+             */
+            bool get(int addr, bool force = false, bool* ret = nullptr);
+            /**
+             * @brief Write a coil (FC5) and update the image
+             *
+             * @param addr Address of the coil
+             * @param value Value to be written
+             * @return true Writing succeeded
+             * @return false Writing failed or not a coil table
+             */
+            bool set(int addr, bool value);
+            /**
+             * @brief Read all registered bits
+             *
+             * @return true All registered bits were read
+             * @return false At least one bit could not be read
+             */
+            bool refresh();
+
+        private:
+            /**
+             * @brief Read all registered bits. Requires mtx to be held
+             *
+             */
+            bool refreshLocked();
+            /**
+             * @brief One request for the bits readable[firstBit, lastBit), see #mb::LearnedLayout::Request. Requires mtx to be held
+             *
+             */
+            bool request(const std::vector<int>& readable, size_t firstBit, size_t lastBit, int& error);
+            /**
+             * @brief Image is outdated or the bit could not be read
+             *
+             */
+            bool dirty(int addr) const;
+            bool test(const std::vector<uint64_t>& words, int addr) const;
+            void assign(std::vector<uint64_t>& words, int addr, bool value);
+
+            Device* device;
+            std::mutex mtx;
+            std::set<int> addrs;
+            /**
+             * @brief Packed bits starting at address first
+             *
+             */
+            std::vector<uint64_t> bits;
+            /**
+             * @brief Packed validity of bits, same layout as bits
+             *
+             */
+            std::vector<uint64_t> valid;
+            LearnedLayout layout;
+            int first = 0;
+            std::chrono::steady_clock::time_point time;
+            bool refreshed = false;
+    };
+
+    /**
+     * @brief Read/write bit (FC1/FC5) of a #mb::Device
+     *
+     */
+    class Coil
+    {
+        public:
+            /**
+             * @brief Construct a new Coil object
+             *
+             * @param device_ #mb::Device instance this coil belongs to
+             * @param addr_ Address of the coil
+             */
+            Coil(Device* device_, int addr_);
+            /**
+             * @brief Address of the coil
+             *
+             */
+            const int addr;
+            /**
+             * @brief Get value of the coil
+             *
+             * @param force Read even if the cached value is recent
+             * @param ret Return status (true: success, false: fail)
+             */
+            bool getValue(bool force = false, bool* ret = nullptr) const;
+            /**
+             * @brief Set the value of the coil
+             *
+             * @param value Value to be written
+             * @return true Writing succeeded
+             * @return false Writing failed
+             */
+            bool setValue(bool value);
+        private:
+            Device* device;
+    };
+
+    /**
+     * @brief Read only bit (FC2) of a #mb::Device
+     *
+     */
+    class DiscreteInput
+    {
+        public:
+            /**
+             * @brief Construct a new Discrete Input object
+             *
+             * @param device_ #mb::Device instance this input belongs to
+             * @param addr_ Address of the input
+             */
+            DiscreteInput(Device* device_, int addr_);
+            /**
+             * @brief Address of the input
+             *
+             */
+            const int addr;
+            /**
+             * @brief Get value of the input
+             *
+             * @param force Read even if the cached value is recent
+             * @param ret Return status (true: success, false: fail)
+             */
+            bool getValue(bool force = false, bool* ret = nullptr) const;
+        private:
+            Device* device;
+    };
+}
@@ -0,0 +1,73 @@
+#include "ModbusConnector.h"
+#include <algorithm>
+
+namespace mb{
+
+    Connector::Connector(unsigned int parallel) {
+        for(unsigned int i = 0; i < std::max(parallel, 1u); i++)
+            threads.emplace_back(&Connector::work, this);
+    }
+
+    Connector::~Connector() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    void Connector::add(Device* device) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            devices.push_back(device);
+            pending.push_back(device);
+        }
+        cv.notify_all();
+    }
+
+    unsigned int Connector::countOnline() const {
+        unsigned int count = 0;
+        for(Device* device : devices)
+            count += device->online();
+        return count;
+    }
+
+    unsigned int Connector::online() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return countOnline();
+    }
+
+    unsigned int Connector::size() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return devices.size();
+    }
+
+    bool Connector::waitOnline(float fraction, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lk(mtx);
+        bool reached = false;
+        cv.wait_for(lk, timeout, [&](){
+            reached = countOnline() >= fraction * devices.size();
+            return reached || (pending.empty() && running == 0);
+        });
+        return reached;
+    }
+
+    void Connector::work() {
+        std::unique_lock<std::mutex> lk(mtx);
+        while(true){
+            cv.wait(lk, [this](){ return stopping || !pending.empty(); });
+            if(stopping)
+                return;
+            Device* device = pending.front();
+            pending.pop_front();
+            running++;
+            lk.unlock();
+            device->open();
+            lk.lock();
+            running--;
+            cv.notify_all();
+        }
+    }
+}
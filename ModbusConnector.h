@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ModbusDevice.h"
+
+namespace mb{
+
+    /**
+     * @brief Connects many lazily constructed #mb::Device instances in parallel
+     *
+     * Devices added to the connector are connected by a fixed number of
+     * worker threads, so unreachable devices only block one worker for
+     * #mb::Device::connect_timeout each.
+     */
+    class Connector
+    {
+        public:
+            /**
+             * @brief Construct a new Connector object and start the workers
+             *
+             * @param parallel Maximum number of concurrent connection attempts
+             */
+            explicit Connector(unsigned int parallel = 16);
+            Connector(const Connector& other) = delete;
+            /**
+             * @brief Destroy the Connector object. Waits for running attempts, skips pending ones
+             *
+             */
+            virtual ~Connector();
+
+            /**
+             * @brief Queue a device for connecting
+             *
+             * @param device Device to connect, must outlive the connector
+             */
+            void add(Device* device);
+            /**
+             * @brief Wait until a fraction of the added devices is online
+             *
+             * @param fraction Fraction of devices (0..1)
+             * @param timeout Maximum time to wait
+             * @return true Fraction reached
+             * @return false Timeout, or all attempts finished without reaching the fraction
+             */
+            bool waitOnline(float fraction, std::chrono::milliseconds timeout);
+            /**
+             * @brief Number of added devices that are online
+             *
+             */
+            unsigned int online() const;
+            /**
+             * @brief Number of added devices
+             *
+             */
+            unsigned int size() const;
+
+        private:
+            void work();
+            unsigned int countOnline() const;
+
+            mutable std::mutex mtx;
+            std::condition_variable cv;
+            std::deque<Device*> pending;
+            std::vector<Device*> devices;
+            unsigned int running = 0;
+            bool stopping = false;
+            std::vector<std::thread> threads;
+    };
+}
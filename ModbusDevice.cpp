@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <cerrno>
 #include <exception>
 #include <ModbusDevice.h>
 #include <chrono>
@@ -9,52 +10,51 @@
 
 namespace mb{
 
-    void Device::init(const char* ipAddress_, int port_)
+    void Device::init(const char* ipAddress_, int port_, bool lazy)
     {
         ipAddress = ipAddress_;
         port = port_;
-        _online = connect(ipAddress.c_str(), port);
+        trace_source = Trace::source(ipAddress + ":" + std::to_string(port));
+        if(!lazy)
+            _online = ensureConnected();
     }
 
 
-    Device::Device(const char* ipAddress_, int port_ /* = 502 */){
-        init(ipAddress_, port_);
+    Device::Device(const char* ipAddress_, int port_ /* = 502 */, bool lazy /* = false */){
+        init(ipAddress_, port_, lazy);
     }
 
-    Device::Device(std::string ipAddress_, int port_ /* = 502 */){
-        init(ipAddress_.c_str(), port_);
+    Device::Device(std::string ipAddress_, int port_ /* = 502 */, bool lazy /* = false */){
+        init(ipAddress_.c_str(), port_, lazy);
     }
 
     Device::~Device()
     {
         disconnect();
-        #ifdef MODBUS_DEBUG
-            std::cerr << "modbus device "+ ipAddress + ":" << port << " destroyed" << std::endl;
-        #endif // DEBUG
     }
 
     bool Device::connect(const char* ipAddress_, int port_)
     {
+        TraceStopwatch<TraceLevel::Info> stopwatch;
         connection = modbus_new_tcp(ipAddress_,port_);
         if(!_reconnectEnabled)
             assert(modbus_set_error_recovery(connection, static_cast<modbus_error_recovery_mode>(MODBUS_ERROR_RECOVERY_LINK | MODBUS_ERROR_RECOVERY_PROTOCOL)) == 0);
-        assert(modbus_set_response_timeout(connection, 3, 0) == 0);
+        // libmodbus waits for the tcp connection with the response timeout
+        const auto connect_ms = connect_timeout.count();
+        modbus_set_response_timeout(connection, connect_ms / 1000, (connect_ms % 1000) * 1000);
         assert(modbus_set_byte_timeout(connection, 3, 0) == 0);
         bool connect_error = modbus_connect(connection) < 0;
+        modbus_set_response_timeout(connection, 3, 0);
         if (connect_error)
         {
-            #ifdef MODBUS_DEBUG
-                std::cerr << "modbus connection error \"" << modbus_strerror(errno) <<  "\" to TCP/IP " + ipAddress + ":" << port_ << std::endl;
-            #endif // DEBUG
+            MODBUS_TRACE(TraceLevel::Error, TraceEvent::ConnectError, trace_source, 0, 0, -1, errno);
             modbus_free(connection);
             connection = nullptr;
             return false;
         }
         else
         {
-            #ifdef MODBUS_DEBUG
-                std::cerr << "modbus successfully connected to ip " + ipAddress + ":" << port_ << std::endl;
-            #endif // DEBUG
+            MODBUS_TRACE(TraceLevel::Info, TraceEvent::Connect, trace_source, 0, 0, 0, 0, stopwatch.elapsed());
             return true;
         }
     }
@@ -64,12 +64,31 @@ namespace mb{
         modbus_close(connection);
         modbus_free(connection);
         connection = nullptr;
-        #ifdef MODBUS_DEBUG
-            std::cerr << "modbus connection " + ipAddress + ":" << port << " disconnected"<< std::endl;
-        #endif // DEBUG
+        MODBUS_TRACE(TraceLevel::Info, TraceEvent::Disconnect, trace_source);
         return true;
     }
 
+    bool Device::ensureConnected()
+    {
+        if(connection)
+            return true;
+        const auto now = std::chrono::steady_clock::now();
+        if(connectAttempted && now - lastConnectAttempt < connect_retry_interval){
+            errno = ENOTCONN;
+            return false;
+        }
+        connectAttempted = true;
+        lastConnectAttempt = now;
+        _online = connect(ipAddress.c_str(), port);
+        return _online;
+    }
+
+    bool Device::open()
+    {
+        RequestQueue::Ticket lk(modbus_queue, Priority::Bulk);
+        return ensureConnected();
+    }
+
     void test_modbus()
     {
         modbus_t *mb;
@@ -85,8 +104,9 @@ namespace mb{
     }
 
     void Device::setOnline(bool status) const {
-        if(status != _online)
-            _online = status;
+        // atomic, connector threads read the flag while pollers write it
+        if(status != _online.load())
+            _online.store(status);
     }
 
     bool Device::online() const {
@@ -94,18 +114,16 @@ namespace mb{
     }
 
     void Device::reconnect() {
-        std::lock_guard<std::mutex> lk(modbus_mtx);
-        std::cout << "modbus " << ipAddress << ":" << port << " reconnecting..." << std::endl;
+        RequestQueue::Ticket lk(modbus_queue, Priority::Control);
         disconnect();
         int reconnectCounter = 0;
         while(!connection){
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            connect(ipAddress.c_str(), port);
             reconnectCounter++;
-            std::cout << "\ttry: " << reconnectCounter << std::endl;
+            MODBUS_TRACE(TraceLevel::Warning, TraceEvent::Reconnect, trace_source, 0, 0, reconnectCounter);
+            connect(ipAddress.c_str(), port);
         }
         _online = true;
-        std::cout << "reconnected" << std::endl;
     }
 
     void Device::enableReconnect(bool reconnect) {
@@ -119,4 +137,20 @@ namespace mb{
     bool Device::reconnectEnabled() const {
         return _reconnectEnabled;
     }
+
+    bool Device::publish(unsigned int slots, std::string name) {
+        // registers keep their slot index and a raw pointer to the image
+        if(_sharedImage)
+            return false;
+        if(name.empty())
+            name = SharedImage::defaultName(ipAddress, port);
+        _sharedImage = std::make_unique<SharedImage>(name, ipAddress + ":" + std::to_string(port), slots);
+        if(!_sharedImage->valid())
+            _sharedImage.reset();
+        return _sharedImage != nullptr;
+    }
+
+    SharedImage* Device::sharedImage() const {
+        return _sharedImage.get();
+    }
 }
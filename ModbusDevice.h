@@ -6,6 +6,13 @@
 #include <thread>
 #include <mutex>
 #include <Subject.h>
+#include "ModbusRequestQueue.h"
+#include "ModbusSharedImage.h"
+#include "ModbusBitTable.h"
+#include "ModbusTrace.h"
+#include <atomic>
+#include <memory>
+#include <chrono>
 
 
 namespace mb{
@@ -34,27 +41,55 @@ namespace mb{
              *
              * @param ipAddress Ip address of the device
              * @param port Port number of the device
+             * @param lazy Do not connect in the constructor, see #ensureConnected
              */
-            Device(const char* ipAddress, int port = 502);
+            Device(const char* ipAddress, int port = 502, bool lazy = false);
             /**
              * @brief Construct a new Device object
              *
              * @param ipAddress Ip address of the device
              * @param port Port number of the device
+             * @param lazy Do not connect in the constructor, see #ensureConnected
              */
-            Device(std::string ipAddress, int port = 502);
+            Device(std::string ipAddress, int port = 502, bool lazy = false);
             Device(const Device& other) = delete;
             virtual ~Device();
             /**
              * @brief Modbus connection pointer
              *
              */
-            modbus_t* connection;
+            modbus_t* connection = nullptr;
             /**
-             * @brief Modbus connection mutex
+             * @brief Modbus request queue
              *
+             * Serializes access to #connection, see #mb::RequestQueue::Ticket.
              */
-            std::mutex modbus_mtx;
+            RequestQueue modbus_queue;
+            /**
+             * @brief Timeout for establishing the connection
+             *
+             */
+            std::chrono::milliseconds connect_timeout{1000};
+            /**
+             * @brief Minimum time between two connection attempts of #ensureConnected
+             *
+             */
+            std::chrono::milliseconds connect_retry_interval{5000};
+            /**
+             * @brief Coils of the device, see #mb::Coil
+             *
+             */
+            BitTable coils{this, Table::Coils};
+            /**
+             * @brief Discrete inputs of the device, see #mb::DiscreteInput
+             *
+             */
+            BitTable discrete_inputs{this, Table::DiscreteInputs};
+            /**
+             * @brief Id of the device in trace records, see #mb::Trace::source
+             *
+             */
+            uint32_t trace_source = 0;
             /**
              * @brief Connect to physical device
              *
@@ -71,6 +106,24 @@ namespace mb{
              * @return false: Disconnecting failed
              */
             bool disconnect();
+            /**
+             * @brief Connect if not connected yet
+             *
+             * Requires #modbus_queue to be held. Does not retry within
+             * #connect_retry_interval after a failed attempt. Callers must not
+             * use #connection if it fails.
+             *
+             * @return true Connected
+             * @return false Not connected, errno is set (ENOTCONN within the retry interval)
+             */
+            bool ensureConnected();
+            /**
+             * @brief Queue in #modbus_queue and connect if not connected yet
+             *
+             * @return true Connected
+             * @return false Not connected
+             */
+            bool open();
             /**
              * @brief Online status of device
              *
@@ -84,19 +137,43 @@ namespace mb{
 
             void reconnect();
 
+            /**
+             * @brief Publish the registers of the device into a shared memory segment
+             *
+             * Registers allocate their slot on their first update after this call.
+             * Must be called once before the device is polled, the segment lives
+             * as long as the device and cannot be replaced.
+             *
+             * @param slots Maximum number of registers
+             * @param name Name of the segment, empty: #mb::SharedImage::defaultName
+             * @return true Segment created
+             * @return false Segment could not be created or the device is already published
+             */
+            bool publish(unsigned int slots = 256, std::string name = "");
+            /**
+             * @brief Shared memory segment of the device, nullptr if not published
+             *
+             * The pointer stays valid for the lifetime of the device.
+             */
+            SharedImage* sharedImage() const;
+
         protected:
-            mutable bool _online = false;
+            mutable std::atomic<bool> _online{false};
         private:
             /**
              * @brief Initialize device. Called inside constructor
              *
              * @param ipAddress ipAddress of the device
              * @param port Port number of the device
+             * @param lazy Do not connect
              */
-            void init(const char* ipAddress, int port = 502);
+            void init(const char* ipAddress, int port = 502, bool lazy = false);
 
     private:
         bool _reconnectEnabled = false;
+        std::unique_ptr<SharedImage> _sharedImage;
+        std::chrono::steady_clock::time_point lastConnectAttempt;
+        bool connectAttempted = false;
     };
 
     /**
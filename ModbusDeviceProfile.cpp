@@ -0,0 +1,111 @@
+#include "ModbusDeviceProfile.h"
+#include "ModbusTrace.h"
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace mb{
+
+    namespace {
+        std::vector<RegisterDescriptor> assignOffsets(std::vector<RegisterDescriptor> registers) {
+            uint32_t offset = 0;
+            for(RegisterDescriptor& descriptor : registers){
+                descriptor.offset = offset;
+                offset += descriptor.size;
+            }
+            return registers;
+        }
+    }
+
+    DeviceProfile::DeviceProfile(std::string model_, std::vector<RegisterDescriptor> registers_):
+        model(model_),
+        registers(assignOffsets(std::move(registers_)))
+    {
+        for(size_t i = 0; i < registers.size(); i++){
+            names[registers[i].name] = i;
+            _words += registers[i].size;
+        }
+    }
+
+    uint32_t DeviceProfile::words() const {
+        return _words;
+    }
+
+    int DeviceProfile::index(const std::string& name) const {
+        auto it = names.find(name);
+        if(it == names.end())
+            return -1;
+        return it->second;
+    }
+
+    std::shared_ptr<const DeviceProfile> DeviceProfile::fromTable(const std::string& model, const RegisterSpec* table, size_t count) {
+        std::vector<RegisterDescriptor> registers;
+        registers.reserve(count);
+        for(size_t i = 0; i < count; i++)
+            registers.push_back({table[i].name, table[i].addr, table[i].size, table[i].factor, table[i].unit, table[i].table, 0});
+        return std::make_shared<const DeviceProfile>(model, std::move(registers));
+    }
+
+    std::shared_ptr<const DeviceProfile> DeviceProfile::fromCsv(const std::string& model, const std::string& path) {
+        static std::mutex cache_mtx;
+        // keyed on the model too, the profile carries the model name
+        static std::map<std::pair<std::string, std::string>, std::shared_ptr<const DeviceProfile>> cache;
+        std::lock_guard<std::mutex> lk(cache_mtx);
+        auto cached = cache.find({model, path});
+        if(cached != cache.end())
+            return cached->second;
+
+        std::ifstream file(path);
+        if(!file)
+            return nullptr;
+        std::vector<RegisterDescriptor> registers;
+        std::string line;
+        int lineNumber = 0;
+        while(std::getline(file, line)){
+            lineNumber++;
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if(line.empty() || line[0] == '#' || line.rfind("name,", 0) == 0)
+                continue;
+            std::istringstream stream(line);
+            std::string name, addr, size, factor, unit, table;
+            std::getline(stream, name, ',');
+            std::getline(stream, addr, ',');
+            std::getline(stream, size, ',');
+            std::getline(stream, factor, ',');
+            std::getline(stream, unit, ',');
+            std::getline(stream, table);
+            RegisterDescriptor descriptor{name, 0, 0, 1., unit, Table::HoldingRegisters, 0};
+            if(table == "input")
+                descriptor.table = Table::InputRegisters;
+            const bool validTable = table.empty() || table == "holding" || table == "input";
+            int addrValue = -1;
+            int sizeValue = 0;
+            try{
+                size_t addrEnd, sizeEnd;
+                addrValue = std::stoi(addr, &addrEnd);
+                sizeValue = std::stoi(size, &sizeEnd);
+                // reject trailing garbage like "12abc"
+                if(addrEnd != addr.size() || sizeEnd != size.size())
+                    sizeValue = 0;
+                descriptor.factor = factor.empty() ? 1.f : std::stof(factor);
+            }
+            catch(const std::exception&){
+                sizeValue = 0;
+            }
+            // check the range before narrowing, 258 must not become a size of 2
+            const bool validSize = sizeValue == 1 || sizeValue == 2 || sizeValue == 4;
+            const bool validAddr = addrValue >= 0 && addrValue + sizeValue <= 0x10000;
+            if(name.empty() || !validSize || !validAddr || !validTable){
+                MODBUS_TRACE(TraceLevel::Error, TraceEvent::ProfileError, Trace::source(path), 0, 0, lineNumber);
+                return nullptr;
+            }
+            descriptor.addr = static_cast<uint16_t>(addrValue);
+            descriptor.size = static_cast<uint8_t>(sizeValue);
+            registers.push_back(descriptor);
+        }
+        auto profile = std::make_shared<const DeviceProfile>(model, std::move(registers));
+        cache[{model, path}] = profile;
+        return profile;
+    }
+}
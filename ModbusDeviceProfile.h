@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ModbusTable.h"
+
+namespace mb{
+
+    /**
+     * @brief Compile time description of a register, see #mb::DeviceProfile::fromTable
+     *
+     */
+    struct RegisterSpec {
+        /**
+         * @brief Name of the register, unique within the profile
+         *
+         */
+        const char* name;
+        /**
+         * @brief Address of the register
+         *
+         */
+        uint16_t addr;
+        /**
+         * @brief Length of the register in numbers of words (16bit): 1, 2 or 4
+         *
+         */
+        uint8_t size;
+        /**
+         * @brief Factor to multiply the value of the register
+         *
+         */
+        float factor;
+        /**
+         * @brief Unit of the register value
+         *
+         */
+        const char* unit;
+        /**
+         * @brief #mb::Table::HoldingRegisters or #mb::Table::InputRegisters
+         *
+         */
+        Table table = Table::HoldingRegisters;
+    };
+
+    /**
+     * @brief Immutable description of a register, shared by all devices of a model
+     *
+     */
+    struct RegisterDescriptor {
+        std::string name;
+        uint16_t addr;
+        uint8_t size;
+        float factor;
+        std::string unit;
+        Table table;
+        /**
+         * @brief Offset of the register in the raw data of a #mb::RegisterBank in words
+         *
+         */
+        uint32_t offset;
+    };
+
+    /**
+     * @brief Register map of a device model
+     *
+     * Holds the metadata of all registers once per model, devices only keep
+     * their values in a #mb::RegisterBank. Profiles are immutable and shared
+     * through std::shared_ptr<const DeviceProfile>.
+     */
+    class DeviceProfile
+    {
+        public:
+            /**
+             * @brief Construct a new Device Profile object
+             *
+             * @param model_ Name of the device model
+             * @param registers_ Registers of the model, offsets are assigned by the constructor
+             */
+            DeviceProfile(std::string model_, std::vector<RegisterDescriptor> registers_);
+            DeviceProfile(const DeviceProfile& other) = delete;
+            virtual ~DeviceProfile() = default;
+
+            /**
+             * @brief Name of the device model
+             *
+             */
+            const std::string model;
+            /**
+             * @brief Registers of the model
+             *
+             */
+            const std::vector<RegisterDescriptor> registers;
+            /**
+             * @brief Sum of the sizes of all registers in words
+             *
+             */
+            uint32_t words() const;
+            /**
+             * @brief Index of a register by name
+             *
+             * @param name Name of the register
+             * @return int Index into #registers, -1 if unknown
+             */
+            int index(const std::string& name) const;
+
+            /**
+             * @brief Create a profile from a table, e.g. a constexpr array of #mb::RegisterSpec
+             *
+             * @param model Name of the device model
+             * @param table First entry of the table
+             * @param count Number of entries
+             */
+            static std::shared_ptr<const DeviceProfile> fromTable(const std::string& model, const RegisterSpec* table, size_t count);
+            /**
+             * @brief Load a profile from a CSV file
+             *
+             * One register per line: name,addr,size,factor,unit,table. table is
+             * "holding" (default if empty or missing) or "input". Empty lines,
+             * lines starting with '#' and a header line starting with "name,"
+             * are skipped. Files are only parsed once, later calls with the
+             * same model and path return the same profile.
+             *
+             * @param model Name of the device model
+             * @param path CSV file
+             * @return std::shared_ptr<const DeviceProfile> Profile, nullptr if the file is missing or malformed
+             */
+            static std::shared_ptr<const DeviceProfile> fromCsv(const std::string& model, const std::string& path);
+
+        private:
+            uint32_t _words = 0;
+            std::map<std::string, int> names;
+    };
+}
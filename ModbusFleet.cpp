@@ -0,0 +1,158 @@
+#include "ModbusFleet.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace mb{
+
+    Fleet::Fleet(unsigned int workers_) {
+        if(workers_ == 0)
+            workers_ = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned int i = 0; i < workers_; i++)
+            shards.push_back(std::make_unique<Shard>());
+        for(unsigned int i = 0; i < workers_; i++)
+            threads.emplace_back(&Fleet::work, this, i);
+    }
+
+    Fleet::~Fleet() {
+        stop();
+    }
+
+    void Fleet::stop() {
+        if(stopping.exchange(true))
+            return;
+        for(auto& shard : shards){
+            std::lock_guard<std::mutex> lk(shard->mtx);
+            shard->cv.notify_all();
+        }
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    unsigned int Fleet::add(Device* device, PollFunction poll, std::chrono::milliseconds interval) {
+        auto job = std::make_shared<Job>();
+        job->device = device;
+        job->poll = std::move(poll);
+        job->interval = interval;
+        job->due = clock::now();
+
+        std::lock_guard<std::mutex> lk(mtx);
+        unsigned int shardIndex = 0;
+        size_t fewest = SIZE_MAX;
+        for(unsigned int i = 0; i < shards.size(); i++){
+            std::lock_guard<std::mutex> shardLk(shards[i]->mtx);
+            if(shards[i]->jobs.size() < fewest){
+                fewest = shards[i]->jobs.size();
+                shardIndex = i;
+            }
+        }
+        job->id = nextId++;
+        job->shard = shardIndex;
+        jobs[job->id] = job;
+
+        Shard& shard = *shards[shardIndex];
+        std::lock_guard<std::mutex> shardLk(shard.mtx);
+        shard.jobs.push_back(job);
+        shard.cv.notify_all();
+        return job->id;
+    }
+
+    bool Fleet::remove(unsigned int id) {
+        std::shared_ptr<Job> job;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            auto it = jobs.find(id);
+            if(it == jobs.end())
+                return false;
+            job = it->second;
+            jobs.erase(it);
+        }
+        Shard& shard = *shards[job->shard];
+        std::unique_lock<std::mutex> shardLk(shard.mtx);
+        shard.jobs.erase(std::find(shard.jobs.begin(), shard.jobs.end(), job));
+        shard.cv.wait(shardLk, [&job]{ return !job->running; });
+        return true;
+    }
+
+    unsigned int Fleet::size() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return jobs.size();
+    }
+
+    unsigned int Fleet::workers() const {
+        return shards.size();
+    }
+
+    std::vector<ShardStats> Fleet::stats() const {
+        std::vector<ShardStats> result;
+        for(auto& shard : shards){
+            ShardStats s;
+            {
+                std::lock_guard<std::mutex> lk(shard->mtx);
+                s.devices = shard->jobs.size();
+            }
+            s.polls = shard->polls.load(std::memory_order_relaxed);
+            s.steals = shard->steals.load(std::memory_order_relaxed);
+            result.push_back(s);
+        }
+        return result;
+    }
+
+    std::shared_ptr<Fleet::Job> Fleet::claim(Shard& shard, clock::time_point now, clock::time_point* nextDue) {
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        const size_t count = shard.jobs.size();
+        // continue after the last claimed job so every due job gets its turn
+        for(size_t n = 0; n < count; n++){
+            const size_t i = (shard.cursor + n) % count;
+            Job& job = *shard.jobs[i];
+            if(job.running)
+                continue;
+            if(job.due <= now){
+                job.running = true;
+                shard.cursor = i + 1;
+                return shard.jobs[i];
+            }
+            if(nextDue)
+                *nextDue = std::min(*nextDue, job.due);
+        }
+        return nullptr;
+    }
+
+    void Fleet::run(Job& job) {
+        job.poll(*job.device);
+        std::chrono::milliseconds interval = job.interval;
+        if(!job.device->online())
+            interval = std::max(interval, offline_interval);
+
+        Shard& owner = *shards[job.shard];
+        std::lock_guard<std::mutex> lk(owner.mtx);
+        job.due = clock::now() + interval;
+        job.running = false;
+        owner.cv.notify_all();
+    }
+
+    void Fleet::work(unsigned int index) {
+        Shard& own = *shards[index];
+        while(!stopping){
+            const clock::time_point now = clock::now();
+            // wake up regularly to steal due jobs of other shards
+            clock::time_point nextDue = now + std::chrono::milliseconds(20);
+            std::shared_ptr<Job> job = claim(own, now, &nextDue);
+            bool stolen = false;
+            for(unsigned int n = 1; !job && n < shards.size(); n++){
+                job = claim(*shards[(index + n) % shards.size()], now, nullptr);
+                stolen = job != nullptr;
+            }
+            if(job){
+                run(*job);
+                own.polls.fetch_add(1, std::memory_order_relaxed);
+                if(stolen)
+                    own.steals.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(own.mtx);
+            if(stopping)
+                break;
+            own.cv.wait_until(lk, nextDue);
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ModbusDevice.h"
+
+namespace mb{
+
+    /**
+     * @brief Polling statistics of one #mb::Fleet worker
+     *
+     */
+    struct ShardStats {
+        /**
+         * @brief Number of devices assigned to the shard
+         *
+         */
+        unsigned int devices = 0;
+        /**
+         * @brief Number of polls executed by the worker
+         *
+         */
+        unsigned long polls = 0;
+        /**
+         * @brief Number of polls the worker stole from other shards
+         *
+         */
+        unsigned long steals = 0;
+    };
+
+    /**
+     * @brief Multi-threaded polling engine for many #mb::Device instances
+     *
+     * Devices are sharded over a fixed number of worker threads. Every worker
+     * polls the devices of its own shard when they are due. A worker without
+     * due devices steals due devices from other shards, so a shard whose
+     * worker is blocked by slow or offline devices does not delay the rest
+     * of its devices.
+     */
+    class Fleet
+    {
+        public:
+            /**
+             * @brief Function polling a device, called from a worker thread
+             *
+             */
+            using PollFunction = std::function<void(Device&)>;
+
+            /**
+             * @brief Construct a new Fleet object and start the workers
+             *
+             * @param workers Number of worker threads (0: one per hardware thread)
+             */
+            explicit Fleet(unsigned int workers = 0);
+            Fleet(const Fleet& other) = delete;
+            virtual ~Fleet();
+
+            /**
+             * @brief Add a device to the fleet
+             *
+             * The device is assigned to the shard with the fewest devices and
+             * polled for the first time as soon as possible.
+             *
+             * @param device Device to poll, must outlive its membership in the fleet
+             * @param poll Function polling the device
+             * @param interval Polling interval
+             * @return unsigned int Id used to remove the device
+             */
+            unsigned int add(Device* device, PollFunction poll, std::chrono::milliseconds interval);
+            /**
+             * @brief Remove a device from the fleet
+             *
+             * Blocks until a running poll of the device has finished, afterwards
+             * the device may be destroyed.
+             *
+             * @param id Id returned by #add
+             * @return true Device removed
+             * @return false Unknown id
+             */
+            bool remove(unsigned int id);
+            /**
+             * @brief Number of devices in the fleet
+             *
+             */
+            unsigned int size() const;
+            /**
+             * @brief Number of worker threads
+             *
+             */
+            unsigned int workers() const;
+            /**
+             * @brief Get the polling statistics of all shards
+             *
+             */
+            std::vector<ShardStats> stats() const;
+            /**
+             * @brief Stop and join all workers. Called by the destructor
+             *
+             */
+            void stop();
+
+            /**
+             * @brief Polling interval used for devices that are offline
+             *
+             * Used instead of the regular interval if it is longer, so that
+             * unreachable devices do not occupy the workers.
+             */
+            std::chrono::milliseconds offline_interval{5000};
+
+        private:
+            using clock = std::chrono::steady_clock;
+
+            struct Job {
+                unsigned int id;
+                unsigned int shard;
+                Device* device;
+                PollFunction poll;
+                std::chrono::milliseconds interval;
+                clock::time_point due;
+                bool running = false;
+            };
+
+            /**
+             * @brief State of one worker, aligned to its own cache lines
+             *
+             * jobs, due and running flags are protected by mtx. The counters are
+             * only written by the worker of the shard.
+             */
+            struct alignas(64) Shard {
+                std::mutex mtx;
+                std::condition_variable cv;
+                std::vector<std::shared_ptr<Job>> jobs;
+                size_t cursor = 0;
+                // counters on their own line so stats() readers do not contend with the mutex
+                alignas(64) std::atomic<unsigned long> polls{0};
+                std::atomic<unsigned long> steals{0};
+            };
+
+            /**
+             * @brief Claim a due job of a shard
+             *
+             * @param shard Shard to search
+             * @param now Current time
+             * @param nextDue Set to the earliest due time of the jobs not claimed, may be nullptr
+             * @return std::shared_ptr<Job> Claimed job or nullptr
+             */
+            std::shared_ptr<Job> claim(Shard& shard, clock::time_point now, clock::time_point* nextDue);
+            void run(Job& job);
+            void work(unsigned int index);
+
+            std::vector<std::unique_ptr<Shard>> shards;
+            std::vector<std::thread> threads;
+            mutable std::mutex mtx;
+            std::map<unsigned int, std::shared_ptr<Job>> jobs;
+            unsigned int nextId = 0;
+            std::atomic<bool> stopping{false};
+    };
+}
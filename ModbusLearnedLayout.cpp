@@ -0,0 +1,80 @@
+#include "ModbusLearnedLayout.h"
+#include "ModbusTable.h"
+
+namespace mb{
+
+    bool LearnedLayout::read(size_t first, size_t last, const Bounds& bounds, const Request& request, const Failure& failure) {
+        int error = 0;
+        if(request(first, last, error))
+            return true;
+        if(error != EMBXILADD){
+            if(!isExceptionResponse(error))
+                _transportError = true;
+            failure(first, last);
+            return false;
+        }
+        if(last - first == 1){
+            const std::pair<int, int> unit = bounds(first);
+            markHoles(unit.first, unit.second);
+            failure(first, last);
+            return false;
+        }
+        const size_t middle = (first + last) / 2;
+        const size_t known = _holes.size() + _boundaries.size();
+        const bool lower = read(first, middle, bounds, request, failure);
+        const bool upper = read(middle, last, bounds, request, failure);
+        // both halves readable without finding a hole, so the hole is in between.
+        // Without a gap the device rejects reads across the border of the halves
+        if(lower && upper && _holes.size() + _boundaries.size() == known){
+            const int end = bounds(middle - 1).second;
+            const int addr = bounds(middle).first;
+            if(end < addr)
+                markHoles(end, addr);
+            else{
+                _boundaries.insert(addr);
+                _revision++;
+            }
+        }
+        return lower && upper;
+    }
+
+    bool LearnedLayout::mergeable(int addr, int end) const {
+        auto hole = _holes.lower_bound(addr);
+        if(hole != _holes.end() && *hole < end)
+            return false;
+        auto boundary = _boundaries.upper_bound(addr);
+        return boundary == _boundaries.end() || *boundary >= end;
+    }
+
+    const std::set<int>& LearnedLayout::holes() const {
+        return _holes;
+    }
+
+    const std::set<int>& LearnedLayout::boundaries() const {
+        return _boundaries;
+    }
+
+    void LearnedLayout::assign(std::set<int> holes, std::set<int> boundaries) {
+        _holes = std::move(holes);
+        _boundaries = std::move(boundaries);
+        _revision++;
+    }
+
+    unsigned int LearnedLayout::revision() const {
+        return _revision;
+    }
+
+    bool LearnedLayout::transportError() const {
+        return _transportError;
+    }
+
+    void LearnedLayout::resetErrors() {
+        _transportError = false;
+    }
+
+    void LearnedLayout::markHoles(int addr, int end) {
+        for(int a = addr; a < end; a++)
+            _holes.insert(a);
+        _revision++;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <set>
+#include <utility>
+
+namespace mb{
+
+    /**
+     * @brief Unmapped addresses and block boundaries of a device table, learned from failed reads
+     *
+     * Shared by #mb::ReadPlanner and #mb::BitTable. Callers read a sorted list
+     * of units (registered ranges or bits) in groups with one request each. A
+     * request answered with ILLEGAL DATA ADDRESS is split until the unmapped
+     * hole is found, the hole is remembered and never read across again. If
+     * both halves of a split are readable the device rejects reads across
+     * their border (e.g. a register block boundary), the border is remembered
+     * the same way.
+     */
+    class LearnedLayout
+    {
+        public:
+            /**
+             * @brief Address range [addr, end) of a unit
+             *
+             */
+            using Bounds = std::function<std::pair<int, int>(size_t unit)>;
+            /**
+             * @brief Read units [first, last) with one request
+             *
+             * Delivers the data on success. Returns false and sets error to
+             * errno on failure, without reporting the failure to the units.
+             */
+            using Request = std::function<bool(size_t first, size_t last, int& error)>;
+            /**
+             * @brief Report units [first, last) as failed
+             *
+             */
+            using Failure = std::function<void(size_t first, size_t last)>;
+
+            /**
+             * @brief Read units [first, last), splitting the request on ILLEGAL DATA ADDRESS
+             *
+             * @return true All units were read
+             * @return false At least one unit failed
+             */
+            bool read(size_t first, size_t last, const Bounds& bounds, const Request& request, const Failure& failure);
+            /**
+             * @brief One request may cover [addr, end) without crossing a known hole or boundary
+             *
+             */
+            bool mergeable(int addr, int end) const;
+
+            /**
+             * @brief Addresses known to be unmapped
+             *
+             */
+            const std::set<int>& holes() const;
+            /**
+             * @brief Addresses a read must not cross, a request may start but not continue at them
+             *
+             */
+            const std::set<int>& boundaries() const;
+            /**
+             * @brief Replace the learned holes and boundaries (e.g. loaded from a file)
+             *
+             */
+            void assign(std::set<int> holes, std::set<int> boundaries);
+            /**
+             * @brief Incremented whenever a hole or boundary is learned or assigned
+             *
+             */
+            unsigned int revision() const;
+
+            /**
+             * @brief A read since the last #resetErrors failed without an exception response
+             *
+             * An exception response proves the device is reachable, any other
+             * error is a transport failure.
+             */
+            bool transportError() const;
+            void resetErrors();
+
+        private:
+            void markHoles(int addr, int end);
+
+            std::set<int> _holes;
+            std::set<int> _boundaries;
+            unsigned int _revision = 0;
+            bool _transportError = false;
+    };
+}
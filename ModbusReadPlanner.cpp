@@ -0,0 +1,208 @@
+#include "ModbusReadPlanner.h"
+#include "ModbusDevice.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace mb{
+
+    ReadPlanner::ReadPlanner(std::string model_, Table table_):
+        model(model_),
+        table(table_)
+    {
+    }
+
+    void ReadPlanner::add(int addr, int size, Sink sink) {
+        ranges.push_back({addr, size, std::move(sink)});
+        dirty = true;
+    }
+
+    const std::set<int>& ReadPlanner::holes() const {
+        return layout.holes();
+    }
+
+    const std::set<int>& ReadPlanner::boundaries() const {
+        return layout.boundaries();
+    }
+
+    const std::vector<ReadPlanner::Block>& ReadPlanner::plan() {
+        if(!dirty && plannedRevision == layout.revision())
+            return blocks;
+        dirty = false;
+        plannedRevision = layout.revision();
+
+        std::vector<size_t> order(ranges.size());
+        for(size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b){
+            return ranges[a].addr < ranges[b].addr;
+        });
+        units.clear();
+        for(size_t i : order){
+            const Range& range = ranges[i];
+            if(!units.empty() && range.addr < units.back().end){
+                units.back().end = std::max(units.back().end, range.addr + range.size);
+                units.back().ranges.push_back(i);
+            }
+            else{
+                units.push_back({range.addr, range.addr + range.size, {i}});
+            }
+        }
+
+        blocks.clear();
+        blockUnits.clear();
+        for(size_t i = 0; i < units.size(); i++){
+            if(!blocks.empty()){
+                Block& block = blocks.back();
+                const int gap = units[i].addr - (block.addr + block.size);
+                const int size = units[i].end - block.addr;
+                // never read across a known hole or boundary, it fails the whole block
+                if(size <= MODBUS_MAX_READ_REGISTERS
+                    && (gap <= 0 || gap * register_cost < request_cost)
+                    && layout.mergeable(block.addr, units[i].end))
+                {
+                    block.size = size;
+                    blockUnits.back().second = i + 1;
+                    continue;
+                }
+            }
+            blocks.push_back({units[i].addr, units[i].end - units[i].addr});
+            blockUnits.push_back({i, i + 1});
+        }
+        return blocks;
+    }
+
+    bool ReadPlanner::execute(Device& device, Priority priority) {
+        plan();
+        bool result = true;
+        layout.resetErrors();
+        const std::vector<std::pair<size_t, size_t>> current = blockUnits;
+        for(const auto& block : current)
+            result = read(device, priority, block.first, block.second) && result;
+        // an exception response proves the device is reachable
+        device.setOnline(!layout.transportError());
+
+        executions++;
+        if(replan_interval > 0 && executions % replan_interval == 0)
+            refit();
+        return result;
+    }
+
+    bool ReadPlanner::read(Device& device, Priority priority, size_t first, size_t last) {
+        return layout.read(first, last,
+            [this](size_t unit){ return std::make_pair(units[unit].addr, units[unit].end); },
+            [this, &device, priority](size_t first, size_t last, int& error){ return request(device, priority, first, last, error); },
+            [this](size_t first, size_t last){ dispatch(first, last, units[first].addr, nullptr); });
+    }
+
+    bool ReadPlanner::request(Device& device, Priority priority, size_t first, size_t last, int& error) {
+        const int addr = units[first].addr;
+        const int size = units[last - 1].end - addr;
+        std::vector<uint16_t> data(size, 0);
+        int status;
+        std::chrono::duration<float, std::milli> duration;
+        {
+            RequestQueue::Ticket lk(device.modbus_queue, priority);
+            const auto start = std::chrono::steady_clock::now();
+            status = device.ensureConnected() ? readRegisters(device.connection, table, addr, size, data.data()) : -1;
+            error = errno;
+            duration = std::chrono::steady_clock::now() - start;
+        }
+        if(status == size){
+            MODBUS_TRACE(TraceLevel::Debug, TraceEvent::Read, device.trace_source, addr, size, status, 0, std::chrono::duration_cast<std::chrono::nanoseconds>(duration));
+            record(size, duration.count());
+            dispatch(first, last, addr, data.data());
+            return true;
+        }
+        MODBUS_TRACE(TraceLevel::Error, TraceEvent::ReadError, device.trace_source, addr, size, status, error, std::chrono::duration_cast<std::chrono::nanoseconds>(duration));
+        return false;
+    }
+
+    void ReadPlanner::dispatch(size_t first, size_t last, int addr, const uint16_t* data) {
+        for(size_t u = first; u < last; u++){
+            for(size_t i : units[u].ranges){
+                const Range& range = ranges[i];
+                if(data)
+                    range.sink(data + (range.addr - addr), range.size);
+                else
+                    range.sink(nullptr, -1);
+            }
+        }
+    }
+
+    void ReadPlanner::record(int size, float milliseconds) {
+        // decay old samples so the model follows changes of the device
+        constexpr double decay = 0.99;
+        n = n * decay + 1;
+        sx = sx * decay + size;
+        sy = sy * decay + milliseconds;
+        sxx = sxx * decay + static_cast<double>(size) * size;
+        sxy = sxy * decay + size * static_cast<double>(milliseconds);
+    }
+
+    void ReadPlanner::refit() {
+        const double variance = n * sxx - sx * sx;
+        // all samples of (nearly) the same size do not tell the cost per register
+        if(n < 2 || variance < 1e-6 * n * n)
+            return;
+        const double slope = (n * sxy - sx * sy) / variance;
+        const double intercept = (sy - slope * sx) / n;
+        // a request is never free, otherwise no gap would ever be worth merging
+        constexpr double minRequestCost = 0.01;
+        register_cost = static_cast<float>(std::max(slope, 0.));
+        request_cost = static_cast<float>(std::max(intercept, minRequestCost));
+        dirty = true;
+    }
+
+    bool ReadPlanner::save(const std::string& path) const {
+        std::ofstream file(path);
+        if(!file)
+            return false;
+        file << "model " << model << "\n";
+        file << "request_cost " << request_cost << "\n";
+        file << "register_cost " << register_cost << "\n";
+        for(int hole : layout.holes())
+            file << "hole " << hole << "\n";
+        for(int boundary : layout.boundaries())
+            file << "boundary " << boundary << "\n";
+        return static_cast<bool>(file);
+    }
+
+    bool ReadPlanner::load(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        if(!std::getline(file, line) || line != "model " + model)
+            return false;
+        float requestCost = request_cost;
+        float registerCost = register_cost;
+        std::set<int> loaded;
+        std::set<int> loadedBoundaries;
+        while(std::getline(file, line)){
+            std::istringstream stream(line);
+            std::string key;
+            stream >> key;
+            if(key == "request_cost")
+                stream >> requestCost;
+            else if(key == "register_cost")
+                stream >> registerCost;
+            else if(key == "hole"){
+                int hole;
+                stream >> hole;
+                loaded.insert(hole);
+            }
+            else if(key == "boundary"){
+                int boundary;
+                stream >> boundary;
+                loadedBoundaries.insert(boundary);
+            }
+            if(stream.fail())
+                return false;
+        }
+        request_cost = requestCost;
+        register_cost = registerCost;
+        layout.assign(loaded, loadedBoundaries);
+        dirty = true;
+        return true;
+    }
+}
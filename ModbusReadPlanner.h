@@ -0,0 +1,189 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+#include "ModbusLearnedLayout.h"
+#include "ModbusRequestQueue.h"
+#include "ModbusTable.h"
+
+namespace mb{
+
+    class Device;
+
+    /**
+     * @brief Plans and executes coalesced reads of the registers of a #mb::Device
+     *
+     * Registered ranges are merged into blocks across small gaps when the
+     * cost model says one larger request is cheaper than several small ones:
+     * a request costs #request_cost plus #register_cost per register. A block
+     * that is answered with ILLEGAL DATA ADDRESS is split until the unmapped
+     * hole or block boundary is found, both are remembered and never read
+     * across again (see #mb::LearnedLayout). The cost model is refitted from
+     * the measured latency per block size every #replan_interval executions.
+     * Holes, boundaries and costs can be saved and loaded per device model.
+     */
+    class ReadPlanner
+    {
+        public:
+            /**
+             * @brief Receives the data of a registered range
+             *
+             * data points to size words on success (status == size) and is
+             * nullptr if the read failed (status < 0).
+             */
+            using Sink = std::function<void(const uint16_t* data, int status)>;
+
+            /**
+             * @brief One read request of the plan
+             *
+             */
+            struct Block {
+                int addr;
+                int size;
+            };
+
+            /**
+             * @brief Construct a new Read Planner object
+             *
+             * @param model_ Device model the learned plan belongs to
+             * @param table_ Table to read, #mb::Table::HoldingRegisters or #mb::Table::InputRegisters
+             */
+            explicit ReadPlanner(std::string model_, Table table_ = Table::HoldingRegisters);
+            ReadPlanner(const ReadPlanner& other) = delete;
+            virtual ~ReadPlanner() = default;
+
+            /**
+             * @brief Device model the learned plan belongs to
+             *
+             */
+            const std::string model;
+            /**
+             * @brief Table the planned registers belong to
+             *
+             */
+            const Table table;
+
+            /**
+             * @brief Estimated time of a request in milliseconds, independent of its size
+             *
+             */
+            float request_cost = 20;
+            /**
+             * @brief Estimated time per register of a request in milliseconds
+             *
+             */
+            float register_cost = 0.1;
+            /**
+             * @brief Number of executions after which the cost model is refitted, 0: never
+             *
+             */
+            unsigned int replan_interval = 100;
+
+            /**
+             * @brief Register a range to be read
+             *
+             * @param addr Address of the first register
+             * @param size Number of registers
+             * @param sink Receives the data of the range, must stay valid while the planner is used
+             */
+            void add(int addr, int size, Sink sink);
+            /**
+             * @brief Current plan, recomputed if ranges, holes or costs changed
+             *
+             */
+            const std::vector<Block>& plan();
+            /**
+             * @brief Read all blocks of the plan and pass the data to the sinks
+             *
+             * @param device Device to read from
+             * @param priority Priority class of the requests
+             * @return true All blocks were read
+             * @return false At least one block failed
+             */
+            bool execute(Device& device, Priority priority = Priority::Bulk);
+
+            /**
+             * @brief Addresses known to be unmapped
+             *
+             */
+            const std::set<int>& holes() const;
+            /**
+             * @brief Addresses a read must not cross, a block may start but not continue at them
+             *
+             */
+            const std::set<int>& boundaries() const;
+
+            /**
+             * @brief Save the learned holes, boundaries and costs
+             *
+             * @param path File to write
+             * @return true Saving succeeded
+             * @return false Saving failed
+             */
+            bool save(const std::string& path) const;
+            /**
+             * @brief Load holes, boundaries and costs saved for the same model
+             *
+             * @param path File to read
+             * @return true Loading succeeded
+             * @return false File missing, malformed or of a different model
+             */
+            bool load(const std::string& path);
+
+        private:
+            struct Range {
+                int addr;
+                int size;
+                Sink sink;
+            };
+
+            /**
+             * @brief Overlapping ranges read as one
+             *
+             */
+            struct Unit {
+                int addr;
+                int end;
+                std::vector<size_t> ranges;
+            };
+
+            /**
+             * @brief Read units [first, last) as one block, splitting it on ILLEGAL DATA ADDRESS
+             *
+             */
+            bool read(Device& device, Priority priority, size_t first, size_t last);
+            /**
+             * @brief One request for units [first, last), see #mb::LearnedLayout::Request
+             *
+             */
+            bool request(Device& device, Priority priority, size_t first, size_t last, int& error);
+            void dispatch(size_t first, size_t last, int addr, const uint16_t* data);
+            void record(int size, float milliseconds);
+            void refit();
+
+            std::vector<Range> ranges;
+            std::vector<Unit> units;
+            /**
+             * @brief Units covered by each block of the plan, [first, last)
+             *
+             */
+            std::vector<std::pair<size_t, size_t>> blockUnits;
+            std::vector<Block> blocks;
+            LearnedLayout layout;
+            /**
+             * @brief Revision of #layout the current plan was made for
+             *
+             */
+            unsigned int plannedRevision = 0;
+            bool dirty = true;
+            unsigned int executions = 0;
+
+            /**
+             * @brief Decaying sums for the least squares fit of latency over block size
+             *
+             */
+            double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    };
+}
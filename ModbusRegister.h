@@ -6,7 +6,12 @@
 #include <cassert>
 #include "ModbusDevice.h"
 #include "ModbusRegisterCache.h"
+#include "ModbusReadPlanner.h"
+#include "ModbusTable.h"
 #include <iostream>
+#include "ModbusTrace.h"
+#include <limits>
+#include <mutex>
 
 namespace mb{
 
@@ -27,14 +32,17 @@ namespace mb{
              * @param addr_ Address of the register
              * @param factor_ Factor to multiply the value of the register
              * @param unit_ Unit of the register value
+             * @param table_ Table of the register, #mb::Table::HoldingRegisters or #mb::Table::InputRegisters
              */
-            explicit Register(Device* device_, int addr_, float factor_ = 1., std::string unit_ = "") :
+            explicit Register(Device* device_, int addr_, float factor_ = 1., std::string unit_ = "", Table table_ = Table::HoldingRegisters) :
                 addr(addr_),
                 factor(factor_),
                 unit(unit_),
+                table(table_),
                 dataSize(sizeof(T)/2),
                 device(device_)
             {
+                assert((table == Table::InputRegisters || table == Table::HoldingRegisters) && "Register reads input or holding registers, use Coil or DiscreteInput for bits");
                 data_cache = std::make_unique<RegisterCache>(dataSize);
             }
             Register(const Register& other) = delete;
@@ -55,9 +63,26 @@ namespace mb{
              *
              */
             std::string unit = "";
+            /**
+             * @brief Table of the register
+             *
+             */
+            const Table table;
 
             int cache_max_age{3000}; // milliseconds
 
+            /**
+             * @brief Priority class used when reading the register
+             *
+             * Writes are always queued as #mb::Priority::Control.
+             */
+            Priority priority{Priority::Telemetry};
+
+            /**
+             * @brief Record debug trace events (reads and cache hits) of this register
+             *
+             * Requires MODBUS_TRACE_LEVEL 4, see #mb::Trace.
+             */
             void enable_log(){
                 _enable_log = true;
             }
@@ -66,11 +91,6 @@ namespace mb{
                 _enable_log = false;
             }
 
-            void log(std::string message) const {
-                if(_enable_log)
-                    std::cout << message << std::endl;
-            }
-
         private:
             /**
              * @brief Data vector for raw data of the register
@@ -97,6 +117,66 @@ namespace mb{
 
             bool _enable_log = false;
 
+            /**
+             * @brief Slot of the register in the shared image of #device
+             *
+             */
+            mutable int image_slot = -1;
+            mutable std::once_flag image_slot_flag;
+
+            /**
+             * @brief Convert raw data of the register to T
+             *
+             * @param rawData Raw data, dataSize words
+             * @return T Value of the register, factor applied
+             */
+            T convert(const std::vector<uint16_t>& rawData) const
+            {
+                short temp16{0};
+                int temp32{0};
+                long temp64{0};
+                T tempT{0};
+                switch(rawData.size()) {
+                    case 1:
+                        temp16 = rawData[0];
+                        tempT = static_cast<T>(temp16*factor);
+                        break;
+                    case 2:
+                        temp32 = MODBUS_GET_INT32_FROM_INT16(rawData.data(), 0);
+                        tempT = static_cast<T>(temp32*factor);
+                        break;
+                    case 4:
+                        temp64 = MODBUS_GET_INT64_FROM_INT16(rawData.data(), 0);
+                        tempT = static_cast<T>(temp64*factor);
+                        break;
+                    default:
+                        tempT = std::numeric_limits<T>::quiet_NaN();
+                    break;
+                }
+                return tempT;
+            }
+
+            /**
+             * @brief Update the cache and publish the data to the shared image of #device
+             *
+             * @param data Raw data
+             * @param status Read status
+             */
+            void updateCache(const std::vector<uint16_t>& data, int status) const
+            {
+                data_cache->update(data, status);
+                SharedImage* image = device->sharedImage();
+                if(!image)
+                    return;
+                std::call_once(image_slot_flag, [&](){
+                    image_slot = image->allocate(addr, dataSize, unit);
+                });
+                if(status == dataSize)
+                    image->publish(image_slot, data.data(), status, static_cast<double>(convert(data)));
+                else
+                    image->publish(image_slot, nullptr, status, 0);
+            }
+
         public:
             /**
              * @brief Read raw data from the register
@@ -106,27 +186,23 @@ namespace mb{
              */
             std::vector<uint16_t> readRawData(bool force = false, bool* ret = nullptr, int* status = nullptr) const
             {
-                #ifdef MODBUS_DEBUG
-                log("Reading  " + device->ipAddress + " register " + std::to_string(addr) + ", " + std::to_string(dataSize));
-                #endif
                 if(!force && !data_cache->dirty()){
-                    #ifdef MODBUS_DEBUG
-                    log("Use cache");
-                    #endif
+                    if(_enable_log)
+                        MODBUS_TRACE(TraceLevel::Debug, TraceEvent::CacheHit, device->trace_source, addr, dataSize, dataSize);
                     if(ret)
                         *ret = true;
                     return data_cache->get_data();
                 }
-                #ifdef MODBUS_DEBUG
-                if(force)
-                    log("Forced update");
-                log("Update cache");
-                #endif
                 assert(device != nullptr && "Device must not be nullptr");
                 std::vector<uint16_t> data(dataSize,0);
-                std::lock_guard<std::mutex> lk(device->modbus_mtx);
-                const int _status = modbus_read_registers(device->connection, addr, dataSize, data.data());
-                data_cache->update(data, _status);
+                RequestQueue::Ticket lk(device->modbus_queue, priority);
+                TraceStopwatch<TraceLevel::Debug> stopwatch;
+                const int _status = device->ensureConnected() ? readRegisters(device->connection, table, addr, dataSize, data.data()) : -1;
+                if(_status != dataSize)
+                    MODBUS_TRACE(TraceLevel::Error, TraceEvent::ReadError, device->trace_source, addr, dataSize, _status, errno, stopwatch.elapsed());
+                else if(_enable_log)
+                    MODBUS_TRACE(TraceLevel::Debug, TraceEvent::Read, device->trace_source, addr, dataSize, _status, 0, stopwatch.elapsed());
+                updateCache(data, _status);
                 if(status){
                     *status = _status;
                 }
@@ -136,6 +212,24 @@ namespace mb{
                 return data_cache->get_data();
             }
 
+            /**
+             * @brief Read the register as part of the blocks of a #mb::ReadPlanner
+             *
+             * The register must outlive the use of the planner.
+             *
+             * @param planner Planner of the device of this register
+             */
+            void plan(ReadPlanner& planner)
+            {
+                assert(planner.table == table && "Planner must read the table of the register");
+                planner.add(addr, dataSize, [this](const uint16_t* data, int status){
+                    if(data)
+                        updateCache(std::vector<uint16_t>(data, data + dataSize), status);
+                    else
+                        updateCache(std::vector<uint16_t>(dataSize, 0), status);
+                });
+            }
+
             /**
              * @brief Get value from the register
              *
@@ -146,16 +240,11 @@ namespace mb{
              */
             T getValue(bool force = false, bool* ret = nullptr) const
             {
-                short temp16{0};
-                int temp32{0};
-                long temp64{0};
-                T tempT{0};
                 bool _ret = false;
-                int status;
                 const bool reconnectEnabled = device->reconnectEnabled();
                 std::vector<uint16_t> rawData(dataSize);
                 do{
-                    rawData = readRawData(force, &_ret, &status);
+                    rawData = readRawData(force, &_ret);
                     setDeviceOnline(_ret);
                     if(!_ret && reconnectEnabled)
                         device->reconnect();
@@ -163,34 +252,9 @@ namespace mb{
 
                 if(ret)
                     *ret = _ret;
-                if(!_ret){
-                    std::string assert_message = "\tInvalid data size read from device " + device->ipAddress + ", expected " + std::to_string(dataSize) + " got " + std::to_string(status) + ".\n\t";
-                    assert_message += std::string("Error: \"" + std::string(modbus_strerror(errno)) + "\"\n");
-                    std::cout<<assert_message<<std::endl;
+                if(!_ret)
                     return static_cast<T>(0);
-                }
-                #ifdef MODBUS_DEBUG
-                log("\t success");
-                #endif
-                switch(rawData.size()) {
-                    case 1:
-                        temp16 = rawData[0];
-                        tempT = static_cast<T>(temp16*factor);
-                        break;
-                    case 2:
-                        temp32 = MODBUS_GET_INT32_FROM_INT16(rawData.data(), 0);
-                        tempT = static_cast<T>(temp32*factor);
-                        break;
-                    case 4:
-                        temp64 = MODBUS_GET_INT64_FROM_INT16(rawData.data(), 0);
-                        tempT = static_cast<T>(temp64*factor);
-                        return tempT;
-                        break;
-                    default:
-                        tempT = std::numeric_limits<T>::quiet_NaN();
-                    break;
-                }
-                return tempT;
+                return convert(rawData);
             }
 
             /**
@@ -202,15 +266,26 @@ namespace mb{
             bool writeRawData(const std::vector<uint16_t>& input, bool* ret = nullptr)
             {
                 assert(device != nullptr);
-                std::lock_guard<std::mutex> lk(device->modbus_mtx);
+                if(table != Table::HoldingRegisters){
+                    if(ret)
+                        *ret = false;
+                    return false;
+                }
+                RequestQueue::Ticket lk(device->modbus_queue, Priority::Control);
+                TraceStopwatch<TraceLevel::Info> stopwatch;
                 int status = -1;
-                if(input.size() == 1){
+                const bool connected = device->ensureConnected();
+                if(connected && input.size() == 1){
                     status = modbus_write_register(device->connection, addr, input[0]);
                 }
-                if(status < 0){ // try again if write_register fails
+                if(connected && status < 0){ // try again if write_register fails
                     status = modbus_write_registers(device->connection, addr, dataSize, input.data());
                 }
                 bool result = status == dataSize;
+                if(result)
+                    MODBUS_TRACE(TraceLevel::Info, TraceEvent::Write, device->trace_source, addr, dataSize, status, 0, stopwatch.elapsed());
+                else
+                    MODBUS_TRACE(TraceLevel::Error, TraceEvent::WriteError, device->trace_source, addr, dataSize, status, errno, stopwatch.elapsed());
                 if (ret) {
                     *ret = result;
                 }
@@ -232,9 +307,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             };
 
@@ -253,9 +328,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             };
 
@@ -274,9 +349,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             }
 
@@ -295,9 +370,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             }
 
@@ -316,9 +391,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             }
 
@@ -337,9 +412,9 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             }
 
@@ -358,10 +433,34 @@ namespace mb{
                 if(ret)
                     *ret = status;
                 if(status)
-                    data_cache->update(buffer, dataSize);
+                    updateCache(buffer, dataSize);
                 else
-                    data_cache->update(buffer, -1);
+                    updateCache(buffer, -1);
                 return status;
             }
     };
+
+    /**
+     * @brief Read only input register (FC4) for a #mb::Device
+     *
+     * Writing an input register always fails.
+     *
+     * @tparam T Type of value inside the register (short, unsigned int, int, long, float, double)
+     */
+    template<class T>
+    class InputRegister: public Register<T>{
+        public:
+            /**
+             * @brief Construct a new Input Register object
+             *
+             * @param device_ #mb::Device instance this register belongs to
+             * @param addr_ Address of the register
+             * @param factor_ Factor to multiply the value of the register
+             * @param unit_ Unit of the register value
+             */
+            explicit InputRegister(Device* device_, int addr_, float factor_ = 1., std::string unit_ = "") :
+                Register<T>(device_, addr_, factor_, unit_, Table::InputRegisters)
+            {
+            }
+    };
 }
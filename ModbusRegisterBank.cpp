@@ -0,0 +1,147 @@
+#include "ModbusRegisterBank.h"
+#include "ModbusDevice.h"
+#include <cassert>
+
+namespace mb{
+
+    RegisterBank::RegisterBank(Device* device_, std::shared_ptr<const DeviceProfile> profile_):
+        profile(profile_),
+        device(device_),
+        _raw(profile_->words(), 0),
+        timestamps(profile_->registers.size()),
+        _status(profile_->registers.size(), -1)
+    {
+    }
+
+    const uint16_t* RegisterBank::rawData(size_t index) const {
+        return _raw.data() + profile->registers[index].offset;
+    }
+
+    std::vector<uint16_t> RegisterBank::raw(size_t index) const {
+        std::lock_guard<std::mutex> lk(mtx);
+        const uint16_t* data = rawData(index);
+        return std::vector<uint16_t>(data, data + profile->registers[index].size);
+    }
+
+    int RegisterBank::status(size_t index) const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return _status[index];
+    }
+
+    std::chrono::steady_clock::time_point RegisterBank::timestamp(size_t index) const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return timestamps[index];
+    }
+
+    double RegisterBank::decode(size_t index) const {
+        const RegisterDescriptor& descriptor = profile->registers[index];
+        const uint16_t* data = rawData(index);
+        switch(descriptor.size) {
+            case 1:
+                return static_cast<short>(data[0]) * descriptor.factor;
+            case 2:
+                return MODBUS_GET_INT32_FROM_INT16(data, 0) * descriptor.factor;
+            case 4:
+                return static_cast<long>(MODBUS_GET_INT64_FROM_INT16(data, 0)) * descriptor.factor;
+        }
+        return 0;
+    }
+
+    void RegisterBank::update(size_t index, const uint16_t* data, int status) {
+        const RegisterDescriptor& descriptor = profile->registers[index];
+        timestamps[index] = std::chrono::steady_clock::now();
+        _status[index] = status == descriptor.size ? status : -1;
+        if(_status[index] > 0)
+            std::copy(data, data + descriptor.size, _raw.begin() + descriptor.offset);
+
+        SharedImage* image = device->sharedImage();
+        if(!image)
+            return;
+        if(image_slots.empty()){
+            for(const RegisterDescriptor& d : profile->registers)
+                image_slots.push_back(image->allocate(d.addr, d.size, d.unit));
+        }
+        if(_status[index] > 0)
+            image->publish(image_slots[index], rawData(index), status, decode(index));
+        else
+            image->publish(image_slots[index], nullptr, -1, 0);
+    }
+
+    double RegisterBank::getValue(size_t index, bool force, bool* ret) {
+        assert(index < profile->registers.size());
+        const RegisterDescriptor& descriptor = profile->registers[index];
+        std::unique_lock<std::mutex> lk(mtx);
+        const bool dirty = _status[index] < 0 || std::chrono::steady_clock::now() - timestamps[index] > max_age;
+        if(force || dirty){
+            lk.unlock();
+            uint16_t data[4] = {0};
+            int status;
+            {
+                RequestQueue::Ticket ticket(device->modbus_queue, Priority::Telemetry);
+                TraceStopwatch<TraceLevel::Debug> stopwatch;
+                status = device->ensureConnected() ? readRegisters(device->connection, descriptor.table, descriptor.addr, descriptor.size, data) : -1;
+                if(status != descriptor.size)
+                    MODBUS_TRACE(TraceLevel::Error, TraceEvent::ReadError, device->trace_source, descriptor.addr, descriptor.size, status, errno, stopwatch.elapsed());
+                else
+                    MODBUS_TRACE(TraceLevel::Debug, TraceEvent::Read, device->trace_source, descriptor.addr, descriptor.size, status, 0, stopwatch.elapsed());
+            }
+            device->setOnline(status == descriptor.size);
+            lk.lock();
+            update(index, data, status);
+        }
+        const bool valid = _status[index] > 0;
+        if(ret)
+            *ret = valid;
+        return valid ? decode(index) : 0;
+    }
+
+    bool RegisterBank::setValue(size_t index, double value) {
+        assert(index < profile->registers.size());
+        const RegisterDescriptor& descriptor = profile->registers[index];
+        if(descriptor.table != Table::HoldingRegisters)
+            return false;
+        uint16_t data[4] = {0};
+        const long scaled = static_cast<long>(value / descriptor.factor);
+        switch(descriptor.size) {
+            case 1:
+                data[0] = static_cast<uint16_t>(scaled);
+                break;
+            case 2:
+                MODBUS_SET_INT32_TO_INT16(data, 0, static_cast<int>(scaled));
+                break;
+            case 4:
+                MODBUS_SET_INT64_TO_INT16(data, 0, scaled);
+                break;
+        }
+        int status = -1;
+        {
+            RequestQueue::Ticket ticket(device->modbus_queue, Priority::Control);
+            TraceStopwatch<TraceLevel::Info> stopwatch;
+            const bool connected = device->ensureConnected();
+            if(connected && descriptor.size == 1)
+                status = modbus_write_register(device->connection, descriptor.addr, data[0]);
+            if(connected && status < 0)
+                status = modbus_write_registers(device->connection, descriptor.addr, descriptor.size, data);
+            if(status == descriptor.size)
+                MODBUS_TRACE(TraceLevel::Info, TraceEvent::Write, device->trace_source, descriptor.addr, descriptor.size, status, 0, stopwatch.elapsed());
+            else
+                MODBUS_TRACE(TraceLevel::Error, TraceEvent::WriteError, device->trace_source, descriptor.addr, descriptor.size, status, errno, stopwatch.elapsed());
+        }
+        const bool result = status == descriptor.size;
+        std::lock_guard<std::mutex> lk(mtx);
+        update(index, data, result ? descriptor.size : -1);
+        return result;
+    }
+
+    void RegisterBank::plan(ReadPlanner& planner) {
+        for(size_t i = 0; i < profile->registers.size(); i++){
+            const RegisterDescriptor& descriptor = profile->registers[i];
+            if(descriptor.table != planner.table)
+                continue;
+            planner.add(descriptor.addr, descriptor.size, [this, i](const uint16_t* data, int status){
+                std::lock_guard<std::mutex> lk(mtx);
+                update(i, data, status);
+            });
+        }
+    }
+}
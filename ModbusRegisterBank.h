@@ -0,0 +1,112 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ModbusDeviceProfile.h"
+#include "ModbusReadPlanner.h"
+
+namespace mb{
+
+    class Device;
+
+    /**
+     * @brief Values of all registers of a #mb::DeviceProfile for one #mb::Device
+     *
+     * Lightweight alternative to one #mb::Register per register: the metadata
+     * lives in the shared profile, the bank only stores raw data, timestamps
+     * and read status as flat arrays indexed like
+     * #mb::DeviceProfile::registers.
+     */
+    class RegisterBank
+    {
+        public:
+            /**
+             * @brief Construct a new Register Bank object
+             *
+             * @param device_ #mb::Device instance the registers belong to
+             * @param profile_ Register map of the device model
+             */
+            RegisterBank(Device* device_, std::shared_ptr<const DeviceProfile> profile_);
+            RegisterBank(const RegisterBank& other) = delete;
+            virtual ~RegisterBank() = default;
+
+            /**
+             * @brief Register map of the device model
+             *
+             */
+            const std::shared_ptr<const DeviceProfile> profile;
+            /**
+             * @brief Maximum age of a value before it is read again
+             *
+             */
+            std::chrono::duration<float, std::milli> max_age{3000};
+
+            /**
+             * @brief Get the value of a register, factor applied
+             *
+             * @param index Index of the register in the profile
+             * @param force Read even if the cached value is recent
+             * @param ret Return status (true: success, false: fail)
+             * @return double Value of the register, 0 on failure
+             */
+            double getValue(size_t index, bool force = false, bool* ret = nullptr);
+            /**
+             * @brief Set the value of a register, factor applied
+             *
+             * @param index Index of the register in the profile
+             * @param value Value to be written
+             * @return true Writing succeeded
+             * @return false Writing failed or not a holding register
+             */
+            bool setValue(size_t index, double value);
+            /**
+             * @brief Add the registers of the bank in the table of a #mb::ReadPlanner
+             *
+             * Profiles with holding and input registers need one planner per table.
+             *
+             * @param planner Planner of the device of this bank
+             */
+            void plan(ReadPlanner& planner);
+
+            /**
+             * @brief Copy of the raw data of a register, size words
+             *
+             */
+            std::vector<uint16_t> raw(size_t index) const;
+            /**
+             * @brief Last read status of a register, size on success, -1 on failure
+             *
+             */
+            int status(size_t index) const;
+            /**
+             * @brief Time of the last update of a register
+             *
+             */
+            std::chrono::steady_clock::time_point timestamp(size_t index) const;
+
+        private:
+            /**
+             * @brief Store the result of a read or write. Requires mtx to be held
+             *
+             */
+            void update(size_t index, const uint16_t* data, int status);
+            /**
+             * @brief Raw data of a register inside #_raw. Requires mtx to be held
+             *
+             */
+            const uint16_t* rawData(size_t index) const;
+            double decode(size_t index) const;
+
+            Device* device;
+            mutable std::mutex mtx;
+            std::vector<uint16_t> _raw;
+            std::vector<std::chrono::steady_clock::time_point> timestamps;
+            std::vector<int8_t> _status;
+            /**
+             * @brief Slots in the shared image of #device, allocated on the first update
+             *
+             */
+            std::vector<int> image_slots;
+    };
+}
@@ -18,8 +18,8 @@ public:
 private:
     std::chrono::duration<float, std::milli> time;
     std::vector<uint16_t> data;
-    int _register_read_status;
+    int _register_read_status = 0;
     const int size;
-    bool _dirty;
+    bool _dirty = true;
 };
 }
@@ -0,0 +1,93 @@
+#include "ModbusRequestQueue.h"
+#include <algorithm>
+
+namespace mb{
+
+    std::chrono::duration<float, std::milli> QueueStats::mean_wait() const {
+        if(requests == 0)
+            return std::chrono::duration<float, std::milli>(0);
+        return total_wait / static_cast<float>(requests);
+    }
+
+    std::chrono::duration<float, std::milli> RequestQueue::acquire(Priority priority) {
+        std::unique_lock<std::mutex> lk(mtx);
+        const clock::time_point enqueued = clock::now();
+        bool promoted = false;
+        if(busy){
+            const uint64_t id = ++nextId;
+            waiters.push_back({id, priority, enqueued});
+            cv.wait(lk, [this, id]{ return granted == id; });
+            promoted = grantedPromoted;
+        }
+        busy = true;
+
+        const std::chrono::duration<float, std::milli> wait = clock::now() - enqueued;
+        QueueStats& s = _stats[static_cast<unsigned int>(priority)];
+        s.requests++;
+        if(promoted)
+            s.promoted++;
+        s.total_wait += wait;
+        s.max_wait = std::max(s.max_wait, wait);
+        return wait;
+    }
+
+    void RequestQueue::release() {
+        std::lock_guard<std::mutex> lk(mtx);
+        grantNext();
+    }
+
+    void RequestQueue::grantNext() {
+        if(waiters.empty()){
+            busy = false;
+            return;
+        }
+        const clock::time_point now = clock::now();
+        auto next = waiters.end();
+        int nextClass = priorityCount;
+        for(auto it = waiters.begin(); it != waiters.end(); ++it){
+            int effective = static_cast<int>(it->priority);
+            if(aging.count() > 0){
+                const std::chrono::duration<float, std::milli> waited = now - it->enqueued;
+                effective -= static_cast<int>(waited / aging);
+            }
+            // aging never promotes into Control, so control writes wait for at most one request
+            const int floor = it->priority == Priority::Control ? 0 : 1;
+            effective = std::max(effective, floor);
+            // strictly less keeps arrival order within a class
+            if(effective < nextClass){
+                nextClass = effective;
+                next = it;
+            }
+        }
+        granted = next->id;
+        grantedPromoted = nextClass < static_cast<int>(next->priority);
+        waiters.erase(next);
+        cv.notify_all();
+    }
+
+    QueueStats RequestQueue::stats(Priority priority) const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return _stats[static_cast<unsigned int>(priority)];
+    }
+
+    void RequestQueue::resetStats() {
+        std::lock_guard<std::mutex> lk(mtx);
+        for(QueueStats& s : _stats)
+            s = QueueStats();
+    }
+
+    unsigned int RequestQueue::waiting() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return waiters.size();
+    }
+
+    RequestQueue::Ticket::Ticket(RequestQueue& queue_, Priority priority):
+        wait(queue_.acquire(priority)),
+        queue(queue_)
+    {
+    }
+
+    RequestQueue::Ticket::~Ticket() {
+        queue.release();
+    }
+}
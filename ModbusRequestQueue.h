@@ -0,0 +1,163 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+namespace mb{
+
+    /**
+     * @brief Priority class of a request to a #mb::Device
+     *
+     * Lower values are served first.
+     */
+    enum class Priority : uint8_t {
+        Control = 0,   ///< Time critical writes (e.g. curtailment set points)
+        Telemetry = 1, ///< Regular polling of measurements
+        Bulk = 2       ///< Diagnostic and bulk reads
+    };
+
+    /**
+     * @brief Number of #mb::Priority classes
+     *
+     */
+    constexpr unsigned int priorityCount = 3;
+
+    /**
+     * @brief Queue wait statistics of one #mb::Priority class
+     *
+     */
+    struct QueueStats {
+        /**
+         * @brief Number of requests that were granted access
+         *
+         */
+        unsigned long requests = 0;
+        /**
+         * @brief Number of requests granted ahead of their class because of aging
+         *
+         */
+        unsigned long promoted = 0;
+        /**
+         * @brief Sum of the time requests spent waiting in the queue
+         *
+         */
+        std::chrono::duration<float, std::milli> total_wait{0};
+        /**
+         * @brief Longest time a request spent waiting in the queue
+         *
+         */
+        std::chrono::duration<float, std::milli> max_wait{0};
+        /**
+         * @brief Mean time a request spent waiting in the queue
+         *
+         */
+        std::chrono::duration<float, std::milli> mean_wait() const;
+    };
+
+    /**
+     * @brief Per device request queue with priority classes
+     *
+     * Serializes access to the modbus connection of a #mb::Device. When the
+     * connection is released the waiting request with the highest
+     * #mb::Priority is granted next, requests of the same class are served in
+     * arrival order. To prevent starvation a waiting request is promoted by
+     * one class for every #aging interval it has been waiting, but never
+     * into #mb::Priority::Control. A control request therefore waits for at
+     * most the request currently holding the connection.
+     */
+    class RequestQueue
+    {
+        public:
+            RequestQueue() = default;
+            RequestQueue(const RequestQueue& other) = delete;
+            virtual ~RequestQueue() = default;
+
+            /**
+             * @brief Wait time after which a waiting request is promoted by one priority class
+             *
+             */
+            std::chrono::duration<float, std::milli> aging{200};
+
+            /**
+             * @brief Wait until the connection is granted to the caller
+             *
+             * @param priority Priority class of the request
+             * @return std::chrono::duration<float, std::milli> Time spent waiting in the queue
+             */
+            std::chrono::duration<float, std::milli> acquire(Priority priority);
+            /**
+             * @brief Release the connection and grant it to the next waiting request
+             *
+             */
+            void release();
+
+            /**
+             * @brief Get the queue wait statistics of a priority class
+             *
+             * @param priority Priority class
+             * @return QueueStats Copy of the statistics
+             */
+            QueueStats stats(Priority priority) const;
+            /**
+             * @brief Reset the queue wait statistics of all priority classes
+             *
+             */
+            void resetStats();
+            /**
+             * @brief Number of requests currently waiting
+             *
+             */
+            unsigned int waiting() const;
+
+            /**
+             * @brief RAII guard holding the connection of a #mb::RequestQueue
+             *
+             */
+            class Ticket
+            {
+                public:
+                    /**
+                     * @brief Construct a new Ticket object and wait until the connection is granted
+                     *
+                     * @param queue_ Queue to wait in
+                     * @param priority Priority class of the request
+                     */
+                    Ticket(RequestQueue& queue_, Priority priority);
+                    Ticket(const Ticket& other) = delete;
+                    ~Ticket();
+                    /**
+                     * @brief Time spent waiting in the queue
+                     *
+                     */
+                    const std::chrono::duration<float, std::milli> wait;
+                private:
+                    RequestQueue& queue;
+            };
+
+        private:
+            using clock = std::chrono::steady_clock;
+
+            struct Waiter {
+                uint64_t id;
+                Priority priority;
+                clock::time_point enqueued;
+            };
+
+            /**
+             * @brief Pick the next waiter to grant the connection to. Requires mtx to be held
+             *
+             */
+            void grantNext();
+
+            mutable std::mutex mtx;
+            std::condition_variable cv;
+            std::list<Waiter> waiters;
+            bool busy = false;
+            uint64_t nextId = 0;
+            uint64_t granted = 0;
+            bool grantedPromoted = false;
+            QueueStats _stats[priorityCount];
+    };
+}
@@ -0,0 +1,115 @@
+#include "ModbusSharedImage.h"
+#include "ModbusTrace.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mb{
+
+    SharedImage::SharedImage(const std::string& name_, const std::string& device, unsigned int slotCount):
+        name(name_)
+    {
+        length = sizeof(SharedImageHeader) + slotCount * sizeof(SharedImageSlot);
+        // never take over a segment another writer still publishes to
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if(fd < 0 || ftruncate(fd, length) != 0){
+            MODBUS_TRACE(TraceLevel::Error, TraceEvent::ImageError, Trace::source(device), 0, 0, -1, errno);
+            if(fd >= 0){
+                close(fd);
+                shm_unlink(name.c_str());
+            }
+            return;
+        }
+        void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(memory == MAP_FAILED){
+            MODBUS_TRACE(TraceLevel::Error, TraceEvent::ImageError, Trace::source(device), 0, 0, -1, errno);
+            shm_unlink(name.c_str());
+            return;
+        }
+        // ftruncate zero fills the segment, all sequences start even
+        header = static_cast<SharedImageHeader*>(memory);
+        slots = reinterpret_cast<SharedImageSlot*>(header + 1);
+        std::memcpy(header->magic, "MBIMAGE", 8);
+        header->version = version;
+        header->slot_count = slotCount;
+        header->slot_size = sizeof(SharedImageSlot);
+        std::strncpy(header->device, device.c_str(), sizeof(header->device) - 1);
+        header->used.store(0, std::memory_order_release);
+    }
+
+    SharedImage::~SharedImage() {
+        if(!header)
+            return;
+        munmap(header, length);
+        shm_unlink(name.c_str());
+    }
+
+    bool SharedImage::valid() const {
+        return header != nullptr;
+    }
+
+    int SharedImage::allocate(int addr, int size, const std::string& unit) {
+        if(!header)
+            return -1;
+        std::lock_guard<std::mutex> lk(allocate_mtx);
+        const uint32_t index = header->used.load(std::memory_order_relaxed);
+        if(index >= header->slot_count)
+            return -1;
+        SharedImageSlot& slot = slots[index];
+        slot.addr = static_cast<uint16_t>(addr);
+        slot.size = static_cast<uint16_t>(std::min(size, 4));
+        slot.status = 0;
+        std::strncpy(slot.unit, unit.c_str(), sizeof(slot.unit) - 1);
+        header->used.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    void SharedImage::publish(int index, const uint16_t* raw, int status, double value) {
+        if(!header || index < 0 || static_cast<uint32_t>(index) >= header->slot_count)
+            return;
+        SharedImageSlot& slot = slots[index];
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        // concurrent writers of the same slot wait for each other
+        while((sequence & 1) || !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire))
+            sequence = slot.sequence.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.status = status;
+        slot.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        if(raw){
+            std::memcpy(slot.raw, raw, slot.size * sizeof(uint16_t));
+            slot.value = value;
+        }
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    void SharedImage::read(const SharedImageSlot& slot, SharedImageSlot& out) {
+        uint32_t before, after;
+        do{
+            before = slot.sequence.load(std::memory_order_acquire);
+            out.addr = slot.addr;
+            out.size = slot.size;
+            out.status = slot.status;
+            out.timestamp_ns = slot.timestamp_ns;
+            out.value = slot.value;
+            std::memcpy(out.raw, slot.raw, sizeof(out.raw));
+            std::memcpy(out.unit, slot.unit, sizeof(out.unit));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.sequence.load(std::memory_order_relaxed);
+        }while((before & 1) || before != after);
+        out.sequence.store(0, std::memory_order_relaxed);
+    }
+
+    std::string SharedImage::defaultName(const std::string& ipAddress, int port) {
+        std::string result = "/mb_" + ipAddress + "_" + std::to_string(port);
+        std::replace(result.begin(), result.end(), '.', '_');
+        std::replace(result.begin(), result.end(), ':', '_');
+        return result;
+    }
+}
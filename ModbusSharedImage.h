@@ -0,0 +1,212 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace mb{
+
+    /**
+     * @brief Header at offset 0 of a shared register image segment
+     *
+     * Layout (host byte order, all offsets in bytes):
+     * | Offset | Type     | Field      |
+     * |--------|----------|------------|
+     * | 0      | char[8]  | magic      |
+     * | 8      | uint32   | version    |
+     * | 12     | uint32   | slot_count |
+     * | 16     | uint32   | slot_size  |
+     * | 20     | uint32   | used       |
+     * | 24     | char[40] | device     |
+     *
+     * The slots follow at offset 64, slot i is at 64 + i * slot_size.
+     */
+    struct SharedImageHeader {
+        /**
+         * @brief "MBIMAGE" followed by a zero byte
+         *
+         */
+        char magic[8];
+        /**
+         * @brief Layout version, see #mb::SharedImage::version
+         *
+         */
+        uint32_t version;
+        /**
+         * @brief Number of slots in the segment
+         *
+         */
+        uint32_t slot_count;
+        /**
+         * @brief Size of one slot in bytes
+         *
+         */
+        uint32_t slot_size;
+        /**
+         * @brief Number of slots in use, only grows
+         *
+         */
+        std::atomic<uint32_t> used;
+        /**
+         * @brief Zero terminated "ip:port" of the device
+         *
+         */
+        char device[40];
+    };
+
+    /**
+     * @brief One register in a shared register image segment
+     *
+     * Layout (host byte order, all offsets in bytes):
+     * | Offset | Type      | Field        |
+     * |--------|-----------|--------------|
+     * | 0      | uint32    | sequence     |
+     * | 4      | uint16    | addr         |
+     * | 6      | uint16    | size         |
+     * | 8      | int32     | status       |
+     * | 12     | uint32    | reserved     |
+     * | 16     | int64     | timestamp_ns |
+     * | 24     | float64   | value        |
+     * | 32     | uint16[4] | raw          |
+     * | 40     | char[24]  | unit         |
+     *
+     * addr, size and unit are written once before #mb::SharedImageHeader::used
+     * is incremented. All other fields are protected by the seqlock in
+     * sequence: a reader loads sequence, retries while it is odd, copies the
+     * slot and accepts the copy if sequence is unchanged afterwards.
+     */
+    struct alignas(64) SharedImageSlot {
+        /**
+         * @brief Seqlock counter, odd while the slot is being written
+         *
+         */
+        std::atomic<uint32_t> sequence;
+        /**
+         * @brief Address of the register
+         *
+         */
+        uint16_t addr;
+        /**
+         * @brief Length of the register in words (16bit)
+         *
+         */
+        uint16_t size;
+        /**
+         * @brief Last read status, equal to size on success, -1 on failure
+         *
+         */
+        int32_t status;
+        uint32_t reserved;
+        /**
+         * @brief Time of the last update in nanoseconds since the unix epoch
+         *
+         */
+        int64_t timestamp_ns;
+        /**
+         * @brief Decoded value of the last successful read, factor applied
+         *
+         */
+        double value;
+        /**
+         * @brief Raw data of the last successful read
+         *
+         */
+        uint16_t raw[4];
+        /**
+         * @brief Zero terminated unit of the register value
+         *
+         */
+        char unit[24];
+    };
+
+    /**
+     * @brief POSIX shared memory segment publishing the registers of a #mb::Device
+     *
+     * Local processes can map the segment read-only (e.g. /dev/shm/<name> on
+     * linux) and read values without syscalls, see #mb::SharedImageSlot for
+     * the reader protocol and #read for a reference implementation.
+     */
+    class SharedImage
+    {
+        public:
+            /**
+             * @brief Layout version written to the header
+             *
+             */
+            static constexpr uint32_t version = 1;
+
+            /**
+             * @brief Create a shared memory segment
+             *
+             * Fails if a segment with the same name exists, e.g. published by
+             * another process for the same device. A segment left behind by a
+             * crashed process has to be removed first (/dev/shm/<name> on linux).
+             * Check #valid whether the segment could be created.
+             *
+             * @param name Name of the segment, starting with '/'
+             * @param device Device description written to the header
+             * @param slots Maximum number of registers
+             */
+            SharedImage(const std::string& name, const std::string& device, unsigned int slots);
+            SharedImage(const SharedImage& other) = delete;
+            /**
+             * @brief Destroy the Shared Image object and unlink the segment
+             *
+             */
+            virtual ~SharedImage();
+
+            /**
+             * @brief Name of the segment
+             *
+             */
+            const std::string name;
+            /**
+             * @brief Segment was created and mapped
+             *
+             */
+            bool valid() const;
+
+            /**
+             * @brief Allocate a slot for a register
+             *
+             * @param addr Address of the register
+             * @param size Length of the register in words (16bit)
+             * @param unit Unit of the register value
+             * @return int Slot index, -1 if the segment is full
+             */
+            int allocate(int addr, int size, const std::string& unit);
+            /**
+             * @brief Publish the state of a register
+             *
+             * @param slot Slot index returned by #allocate
+             * @param raw Raw data, nullptr keeps the last value (failed read)
+             * @param status Read status
+             * @param value Decoded value
+             */
+            void publish(int slot, const uint16_t* raw, int status, double value);
+
+            /**
+             * @brief Read a slot consistently
+             *
+             * @param slot Slot inside a mapped segment
+             * @param out Copy of the slot, sequence is left zero
+             */
+            static void read(const SharedImageSlot& slot, SharedImageSlot& out);
+
+            /**
+             * @brief Default segment name for a device ("/mb_<ip>_<port>")
+             *
+             */
+            static std::string defaultName(const std::string& ipAddress, int port);
+
+        private:
+            SharedImageHeader* header = nullptr;
+            SharedImageSlot* slots = nullptr;
+            size_t length = 0;
+            std::mutex allocate_mtx;
+    };
+
+    static_assert(sizeof(SharedImageHeader) == 64, "SharedImageHeader layout changed");
+    static_assert(sizeof(SharedImageSlot) == 64, "SharedImageSlot layout changed");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Seqlock requires lock free 32bit atomics");
+}
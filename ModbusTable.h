@@ -0,0 +1,47 @@
+#pragma once
+#include <modbus.h>
+#include <stdint.h>
+
+namespace mb{
+
+    /**
+     * @brief Modbus data table a register or bit belongs to
+     *
+     */
+    enum class Table : uint8_t {
+        Coils,            ///< Read/write bits (FC1, FC5, FC15)
+        DiscreteInputs,   ///< Read only bits (FC2)
+        InputRegisters,   ///< Read only registers (FC4)
+        HoldingRegisters  ///< Read/write registers (FC3, FC6, FC16)
+    };
+
+    /**
+     * @brief Check whether a libmodbus errno is a modbus exception response
+     *
+     * An exception response (EMBXILFUN ... EMBXGTAR) was sent by the device, so
+     * the device is reachable. Any other error is a transport or protocol failure.
+     *
+     * @param error errno after a failed libmodbus call
+     */
+    inline bool isExceptionResponse(int error)
+    {
+        return error >= EMBXILFUN && error <= EMBXGTAR;
+    }
+
+    /**
+     * @brief Read registers from a register table
+     *
+     * @param connection Modbus connection
+     * @param table #mb::Table::InputRegisters or #mb::Table::HoldingRegisters
+     * @param addr Address of the first register
+     * @param nb Number of registers
+     * @param dest Buffer for nb registers
+     * @return int Number of registers read, -1 on failure
+     */
+    inline int readRegisters(modbus_t* connection, Table table, int addr, int nb, uint16_t* dest)
+    {
+        if(table == Table::InputRegisters)
+            return modbus_read_input_registers(connection, addr, nb, dest);
+        return modbus_read_registers(connection, addr, nb, dest);
+    }
+}
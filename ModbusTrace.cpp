@@ -0,0 +1,224 @@
+#include "ModbusTrace.h"
+#include <modbus.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mb{
+
+    namespace {
+        constexpr uint32_t ringSize = 1024;
+
+        /**
+         * @brief Single producer single consumer ring buffer of one thread
+         *
+         */
+        struct Ring {
+            alignas(64) std::atomic<uint32_t> head{0};
+            alignas(64) std::atomic<uint32_t> tail{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<bool> closed{false};
+            TraceRecord records[ringSize];
+        };
+
+        struct Registry {
+            std::mutex mtx;
+            std::vector<std::shared_ptr<Ring>> rings;
+            std::vector<std::string> sources;
+            std::unordered_map<std::string, uint32_t> sourceIds;
+            uint64_t dropped = 0;
+
+            std::mutex sink_mtx;
+            std::condition_variable cv;
+            std::thread thread;
+            bool running = false;
+
+            ~Registry() {
+                {
+                    std::lock_guard<std::mutex> lk(sink_mtx);
+                    running = false;
+                }
+                cv.notify_all();
+                if(thread.joinable())
+                    thread.join();
+            }
+        };
+
+        Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        /**
+         * @brief Ring of the calling thread, closed when the thread exits
+         *
+         */
+        struct ThreadRing {
+            std::shared_ptr<Ring> ring;
+            ThreadRing(): ring(std::make_shared<Ring>()) {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> lk(r.mtx);
+                r.rings.push_back(ring);
+            }
+            ~ThreadRing() {
+                Registry& r = registry();
+                std::lock_guard<std::mutex> sink_lk(r.sink_mtx);
+                if(r.running){
+                    // the sink removes the ring after draining it. Closing under sink_mtx
+                    // guarantees the final drain of stop() still sees the flag
+                    ring->closed.store(true, std::memory_order_release);
+                    return;
+                }
+                std::lock_guard<std::mutex> lk(r.mtx);
+                r.dropped += ring->dropped.load(std::memory_order_relaxed);
+                r.rings.erase(std::find(r.rings.begin(), r.rings.end(), ring));
+            }
+        };
+
+        void drain(const Trace::Sink& sink) {
+            Registry& r = registry();
+            std::vector<std::shared_ptr<Ring>> rings;
+            {
+                std::lock_guard<std::mutex> lk(r.mtx);
+                rings = r.rings;
+            }
+            for(auto& ring : rings){
+                const bool closed = ring->closed.load(std::memory_order_acquire);
+                const uint32_t head = ring->head.load(std::memory_order_relaxed);
+                const uint32_t tail = ring->tail.load(std::memory_order_acquire);
+                for(uint32_t i = head; i != tail; i++)
+                    sink(ring->records[i % ringSize]);
+                ring->head.store(tail, std::memory_order_release);
+                if(closed){
+                    std::lock_guard<std::mutex> lk(r.mtx);
+                    r.dropped += ring->dropped.load(std::memory_order_relaxed);
+                    r.rings.erase(std::find(r.rings.begin(), r.rings.end(), ring));
+                }
+            }
+        }
+    }
+
+    void Trace::record(TraceLevel level, TraceEvent event, uint32_t source, int addr, int size, int status, int error, std::chrono::nanoseconds duration) {
+        thread_local ThreadRing local;
+        Ring& ring = *local.ring;
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+        if(tail - ring.head.load(std::memory_order_acquire) >= ringSize){
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        TraceRecord& record = ring.records[tail % ringSize];
+        record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        record.source = source;
+        record.addr = static_cast<uint16_t>(addr);
+        record.size = static_cast<uint16_t>(size);
+        record.status = status;
+        record.error = error;
+        record.duration_us = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+        record.event = event;
+        record.level = level;
+        record.reserved = 0;
+        ring.tail.store(tail + 1, std::memory_order_release);
+    }
+
+    uint32_t Trace::source(const std::string& name) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.mtx);
+        auto it = r.sourceIds.find(name);
+        if(it != r.sourceIds.end())
+            return it->second;
+        const uint32_t id = r.sources.size();
+        r.sources.push_back(name);
+        r.sourceIds[name] = id;
+        return id;
+    }
+
+    std::string Trace::sourceName(uint32_t source) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.mtx);
+        if(source < r.sources.size())
+            return r.sources[source];
+        return "?";
+    }
+
+    void Trace::start(Sink sink, std::chrono::milliseconds interval) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.sink_mtx);
+        if(r.running)
+            return;
+        if(!sink)
+            sink = [](const TraceRecord& record){ std::cerr << format(record) << std::endl; };
+        r.running = true;
+        r.thread = std::thread([&r, sink, interval](){
+            std::unique_lock<std::mutex> lk(r.sink_mtx);
+            while(r.running){
+                r.cv.wait_for(lk, interval);
+                lk.unlock();
+                drain(sink);
+                lk.lock();
+            }
+            lk.unlock();
+            drain(sink);
+        });
+    }
+
+    void Trace::stop() {
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lk(r.sink_mtx);
+            if(!r.running)
+                return;
+            r.running = false;
+        }
+        r.cv.notify_all();
+        r.thread.join();
+    }
+
+    uint64_t Trace::dropped() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lk(r.mtx);
+        uint64_t result = r.dropped;
+        for(auto& ring : r.rings)
+            result += ring->dropped.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    std::string Trace::format(const TraceRecord& record) {
+        static const char* levels[] = {"", "error", "warning", "info", "debug"};
+        static const char* events[] = {"read", "cache hit", "write", "read error", "write error", "connect", "connect error", "disconnect", "reconnect", "shared image error", "invalid profile"};
+        std::ostringstream stream;
+        stream << record.timestamp_ns / 1000000000 << "." << std::setw(6) << std::setfill('0') << (record.timestamp_ns / 1000) % 1000000 << std::setfill(' ')
+            << " " << levels[static_cast<int>(record.level)]
+            << " modbus " << sourceName(record.source)
+            << " " << events[static_cast<int>(record.event)];
+        switch(record.event){
+            case TraceEvent::Read:
+            case TraceEvent::CacheHit:
+            case TraceEvent::Write:
+            case TraceEvent::ReadError:
+            case TraceEvent::WriteError:
+                stream << " addr " << record.addr << ", size " << record.size << ", status " << record.status;
+                break;
+            case TraceEvent::Reconnect:
+                stream << " try " << record.status;
+                break;
+            case TraceEvent::ProfileError:
+                stream << " line " << record.status;
+                break;
+            default:
+                break;
+        }
+        if(record.error)
+            stream << " \"" << modbus_strerror(record.error) << "\"";
+        if(record.duration_us)
+            stream << " (" << record.duration_us << " us)";
+        return stream.str();
+    }
+}
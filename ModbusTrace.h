@@ -0,0 +1,181 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief Compile time trace level, events above it are compiled out
+ *
+ * 0: off, 1: errors, 2: warnings, 3: info, 4: debug. Set by CMake
+ * (MODBUS_TRACE_LEVEL cache variable).
+ */
+#ifndef MODBUS_TRACE_LEVEL
+#define MODBUS_TRACE_LEVEL 0
+#endif
+
+/**
+ * @brief Record a trace event if its level is enabled at compile time
+ *
+ * Arguments are not evaluated if the level is disabled.
+ *
+ * @param level #mb::TraceLevel of the event
+ * @param ... Arguments of #mb::Trace::record after the level
+ */
+#define MODBUS_TRACE(level, ...) \
+    do{ \
+        if constexpr(::mb::Trace::enabled(level)) \
+            ::mb::Trace::record(level, __VA_ARGS__); \
+    }while(0)
+
+namespace mb{
+
+    /**
+     * @brief Severity of a trace event
+     *
+     */
+    enum class TraceLevel : uint8_t {
+        Error = 1,
+        Warning = 2,
+        Info = 3,
+        Debug = 4
+    };
+
+    /**
+     * @brief Kind of a trace event
+     *
+     */
+    enum class TraceEvent : uint8_t {
+        Read,         ///< Registers or bits read
+        CacheHit,     ///< Value served from the cache
+        Write,        ///< Registers or bits written
+        ReadError,    ///< Read failed, error holds errno
+        WriteError,   ///< Write failed, error holds errno
+        Connect,      ///< Connection established
+        ConnectError, ///< Connecting failed, error holds errno
+        Disconnect,   ///< Connection closed
+        Reconnect,    ///< Reconnect attempt, status holds the attempt number
+        ImageError,   ///< Shared image could not be created, error holds errno
+        ProfileError  ///< Invalid line in a device profile, source is the file, status holds the line number
+    };
+
+    /**
+     * @brief Binary trace record, formatted only by the sink
+     *
+     */
+    struct TraceRecord {
+        /**
+         * @brief Time of the event in nanoseconds since the unix epoch
+         *
+         */
+        int64_t timestamp_ns;
+        /**
+         * @brief Device id returned by #mb::Trace::source
+         *
+         */
+        uint32_t source;
+        uint16_t addr;
+        uint16_t size;
+        int32_t status;
+        int32_t error;
+        uint32_t duration_us;
+        TraceEvent event;
+        TraceLevel level;
+        uint16_t reserved;
+    };
+
+    /**
+     * @brief Low overhead event tracing
+     *
+     * Every thread records into its own lock free ring buffer. A background
+     * thread started by #start drains all buffers and passes the records to
+     * a sink. Records are dropped (and counted) when a buffer is full.
+     */
+    class Trace
+    {
+        public:
+            /**
+             * @brief Receives drained records on the background thread
+             *
+             */
+            using Sink = std::function<void(const TraceRecord&)>;
+
+            /**
+             * @brief Level is enabled at compile time
+             *
+             */
+            static constexpr bool enabled(TraceLevel level) {
+                return static_cast<int>(level) <= MODBUS_TRACE_LEVEL;
+            }
+
+            /**
+             * @brief Record an event. Use #MODBUS_TRACE to compile out disabled levels
+             *
+             */
+            static void record(TraceLevel level, TraceEvent event, uint32_t source, int addr = 0, int size = 0, int status = 0, int error = 0, std::chrono::nanoseconds duration = std::chrono::nanoseconds(0));
+
+            /**
+             * @brief Get the id of a trace source (e.g. "ip:port"), registered on first use
+             *
+             */
+            static uint32_t source(const std::string& name);
+            /**
+             * @brief Name of a trace source
+             *
+             */
+            static std::string sourceName(uint32_t source);
+
+            /**
+             * @brief Start the background thread draining the buffers
+             *
+             * @param sink Receives the records, default: #format to std::cerr
+             * @param interval Time between two drains
+             */
+            static void start(Sink sink = Sink(), std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+            /**
+             * @brief Drain the buffers a last time and stop the background thread
+             *
+             */
+            static void stop();
+            /**
+             * @brief Number of records dropped because a buffer was full
+             *
+             */
+            static uint64_t dropped();
+            /**
+             * @brief Format a record as one line of text
+             *
+             */
+            static std::string format(const TraceRecord& record);
+    };
+
+    /**
+     * @brief Measures the duration of a traced operation, does nothing if the level is disabled
+     *
+     * Reads are timed at #mb::TraceLevel::Debug, so successful reads never
+     * touch the clock below debug level and their read errors are recorded
+     * without a duration.
+     *
+     * @tparam level Level of the event the duration belongs to
+     */
+    template<TraceLevel level>
+    class TraceStopwatch
+    {
+        public:
+            TraceStopwatch(){
+                if constexpr(Trace::enabled(level))
+                    start = std::chrono::steady_clock::now();
+            }
+            /**
+             * @brief Time since construction, zero if the level is disabled
+             *
+             */
+            std::chrono::nanoseconds elapsed() const {
+                if constexpr(Trace::enabled(level))
+                    return std::chrono::steady_clock::now() - start;
+                return std::chrono::nanoseconds(0);
+            }
+        private:
+            std::chrono::steady_clock::time_point start;
+    };
+}
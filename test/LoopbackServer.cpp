@@ -0,0 +1,82 @@
+#include "LoopbackServer.h"
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+LoopbackServer::LoopbackServer(int port_, std::chrono::microseconds latency_, int registers, std::set<int> boundaries_):
+    port(port_),
+    latency(latency_),
+    boundaries(std::move(boundaries_))
+{
+    mapping = modbus_mapping_new_start_address(0, MODBUS_MAX_READ_BITS, 0, MODBUS_MAX_READ_BITS, 0, registers, 0, registers);
+    for(int i = 0; i < registers; i++){
+        mapping->tab_registers[i] = i;
+        mapping->tab_input_registers[i] = i;
+    }
+    server = modbus_new_tcp("127.0.0.1", port);
+    server_socket = modbus_tcp_listen(server, 1024);
+    if(server_socket < 0){
+        // the listener would spin on accept() and every client would fail
+        std::cerr << "LoopbackServer: listen on port " << port << " failed: " << modbus_strerror(errno) << std::endl;
+        std::abort();
+    }
+    listener = std::thread(&LoopbackServer::listen, this);
+}
+
+LoopbackServer::~LoopbackServer(){
+    stopping = true;
+    shutdown(server_socket, SHUT_RDWR);
+    close(server_socket);
+    listener.join();
+    {
+        std::lock_guard<std::mutex> lk(clients_mtx);
+        for(auto& client: clients)
+            client.join();
+    }
+    modbus_free(server);
+    modbus_mapping_free(mapping);
+}
+
+void LoopbackServer::listen(){
+    while(!stopping){
+        int socket = accept(server_socket, nullptr, nullptr);
+        if(socket < 0)
+            continue;
+        std::lock_guard<std::mutex> lk(clients_mtx);
+        clients.emplace_back(&LoopbackServer::serve, this, socket);
+    }
+}
+
+void LoopbackServer::serve(int socket){
+    modbus_t* ctx = modbus_new_tcp("127.0.0.1", port);
+    modbus_set_socket(ctx, socket);
+    uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
+    while(!stopping){
+        const int length = modbus_receive(ctx, query);
+        if(length == 0)
+            continue;
+        if(length < 0)
+            break;
+        if(latency.count() > 0)
+            std::this_thread::sleep_for(latency);
+        if(crossesBoundary(ctx, query))
+            modbus_reply_exception(ctx, query, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+        else
+            modbus_reply(ctx, query, length, mapping);
+    }
+    close(socket);
+    modbus_free(ctx);
+}
+
+bool LoopbackServer::crossesBoundary(modbus_t* ctx, const uint8_t* query) const {
+    const int offset = modbus_get_header_length(ctx);
+    const int function = query[offset];
+    if(function != MODBUS_FC_READ_HOLDING_REGISTERS && function != MODBUS_FC_READ_INPUT_REGISTERS)
+        return false;
+    const int addr = (query[offset + 1] << 8) | query[offset + 2];
+    const int nb = (query[offset + 3] << 8) | query[offset + 4];
+    auto it = boundaries.upper_bound(addr);
+    return it != boundaries.end() && *it < addr + nb;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <modbus.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Modbus TCP server on the loopback interface simulating devices
+ *
+ * Serves every client connection from its own thread. All clients share one
+ * register mapping. Register n holds the value n.
+ */
+class LoopbackServer{
+public:
+    /**
+     * @brief Construct a new Loopback Server object and start listening
+     *
+     * @param port Port to listen on (127.0.0.1)
+     * @param latency Artificial processing time per request
+     * @param registers Number of holding and input registers from address 0, reads past them are answered with ILLEGAL DATA ADDRESS
+     * @param boundaries Register reads crossing one of these addresses are answered with ILLEGAL DATA ADDRESS, like devices with separate register blocks
+     */
+    LoopbackServer(int port, std::chrono::microseconds latency = std::chrono::microseconds(0), int registers = 0x10000, std::set<int> boundaries = {});
+    LoopbackServer(const LoopbackServer& other) = delete;
+    virtual ~LoopbackServer();
+
+    const int port;
+    modbus_mapping_t* mapping;
+
+private:
+    void listen();
+    void serve(int socket);
+    bool crossesBoundary(modbus_t* ctx, const uint8_t* query) const;
+
+    const std::chrono::microseconds latency;
+    const std::set<int> boundaries;
+    modbus_t* server;
+    int server_socket;
+    std::atomic<bool> stopping{false};
+    std::thread listener;
+    std::mutex clients_mtx;
+    std::vector<std::thread> clients;
+};
@@ -7,6 +7,9 @@ TestDevice::TestDevice(std::string ipAddress, int port):
     shortRegister = new mb::Register<short>(this, 40005);
     longRegister = new mb::Register<long>(this, 40005);
     floatRegister = new mb::Register<float>(this, 40005);
+    intInputRegister = new mb::InputRegister<int>(this, 30005);
+    coil = new mb::Coil(this, 0);
+    discreteInput = new mb::DiscreteInput(this, 0);
 }
 
 TestDevice::~TestDevice(){
@@ -18,4 +21,10 @@ TestDevice::~TestDevice(){
     longRegister = nullptr;
     delete floatRegister;
     floatRegister = nullptr;
+    delete intInputRegister;
+    intInputRegister = nullptr;
+    delete coil;
+    coil = nullptr;
+    delete discreteInput;
+    discreteInput = nullptr;
 }
@@ -13,5 +13,8 @@ public:
     mb::Register<short>* shortRegister;
     mb::Register<long>* longRegister;
     mb::Register<float>* floatRegister;
+    mb::InputRegister<int>* intInputRegister;
+    mb::Coil* coil;
+    mb::DiscreteInput* discreteInput;
 private:
 };
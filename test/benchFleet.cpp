@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ModbusFleet.h>
+#include <ModbusRegister.h>
+#include "LoopbackServer.h"
+
+/**
+ * @brief Scaling benchmark of mb::Fleet against the loopback simulator
+ *
+ * Usage: ModbusFleet_bench [devices] [registers per device] [seconds] [latency us]
+ */
+int main(int argc, char **argv){
+    const int deviceCount = argc > 1 ? std::stoi(argv[1]) : 200;
+    const int registerCount = argc > 2 ? std::stoi(argv[2]) : 20;
+    const int seconds = argc > 3 ? std::stoi(argv[3]) : 3;
+    const auto latency = std::chrono::microseconds(argc > 4 ? std::stoi(argv[4]) : 200);
+    const unsigned int maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    LoopbackServer server(1502, latency);
+
+    std::vector<std::unique_ptr<mb::Device>> devices;
+    std::vector<std::vector<std::unique_ptr<mb::Register<int>>>> registers(deviceCount);
+    for(int d = 0; d < deviceCount; d++){
+        devices.push_back(std::make_unique<mb::Device>("127.0.0.1", server.port));
+        for(int r = 0; r < registerCount; r++)
+            registers[d].push_back(std::make_unique<mb::Register<int>>(devices[d].get(), 2 * r));
+    }
+
+    std::cout << deviceCount << " devices, " << registerCount << " registers each, " << latency.count() << " us server latency" << std::endl;
+    double baseline = 0;
+    // powers of two, always ending with all hardware threads
+    std::vector<unsigned int> steps;
+    for(unsigned int workers = 1; workers < maxWorkers; workers *= 2)
+        steps.push_back(workers);
+    steps.push_back(maxWorkers);
+    for(unsigned int workers: steps){
+        std::atomic<unsigned long> reads{0};
+        mb::Fleet fleet(workers);
+        for(int d = 0; d < deviceCount; d++){
+            auto* deviceRegisters = &registers[d];
+            fleet.add(devices[d].get(), [deviceRegisters, &reads](mb::Device&){
+                for(auto& reg: *deviceRegisters){
+                    bool ret = false;
+                    reg->readRawData(true, &ret);
+                    if(ret)
+                        reads++;
+                }
+            }, std::chrono::milliseconds(0));
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        fleet.stop();
+
+        unsigned long steals = 0;
+        for(const mb::ShardStats& s: fleet.stats())
+            steals += s.steals;
+        const double rate = static_cast<double>(reads) / seconds;
+        if(workers == 1)
+            baseline = rate;
+        std::cout << workers << " workers: " << rate << " reads/s, speedup " << rate / baseline << ", " << steals << " steals" << std::endl;
+    }
+    return 0;
+}
@@ -1,8 +1,22 @@
 #include <iostream>
 #include "TestDevice.h"
 #include "RpiDevice.h"
+#include <ModbusRegisterBank.h>
+#include <ModbusConnector.h>
+#include "LoopbackServer.h"
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <iterator>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 void test_rpi_modbus(){
     RpiDevice rpi("192.168.178.107");
@@ -39,9 +53,223 @@ void test_repeated_connection(){
     testDevice.disconnect();
 }
 
+void test_read_planner(){
+    // 40 registers, reads across address 20 are rejected like by a device with two register blocks
+    LoopbackServer server(1503, std::chrono::microseconds(0), 40, {20});
+    mb::Device device("127.0.0.1", server.port);
+    mb::ReadPlanner planner("Loopback");
+    std::map<int, int> values;
+    for(int addr : {0, 2, 4, 18, 20, 36, 40, 44}){
+        planner.add(addr, 2, [addr, &values](const uint16_t* data, int status){
+            values[addr] = status == 2 ? data[0] : -1;
+        });
+    }
+    // all ranges start in one block, the failures are learned over the first executions
+    assert(planner.plan().size() == 1);
+    for(int i = 0; i < 3; i++)
+        planner.execute(device);
+    std::cout << "read planner: " << planner.plan().size() << " blocks, " << planner.holes().size() << " holes, " << planner.boundaries().size() << " boundaries" << std::endl;
+    assert((planner.holes() == std::set<int>{40, 41, 44, 45}));
+    assert((planner.boundaries() == std::set<int>{20}));
+    // [0, 20), [20, 38) and one request per unmapped range
+    assert(planner.plan().size() == 4);
+    assert(values[0] == 0 && values[18] == 18 && values[20] == 20 && values[36] == 36);
+    assert(values[40] == -1 && values[44] == -1);
+    // exception responses do not take the device offline
+    assert(device.online());
+
+    const std::string path = "/tmp/ModbusReadPlanner_test.plan";
+    assert(planner.save(path));
+    mb::ReadPlanner loaded("Loopback");
+    assert(loaded.load(path));
+    assert(loaded.holes() == planner.holes() && loaded.boundaries() == planner.boundaries());
+    assert(loaded.request_cost == planner.request_cost && loaded.register_cost == planner.register_cost);
+    mb::ReadPlanner other("OtherModel");
+    assert(!other.load(path));
+    std::remove(path.c_str());
+
+    // refit from the measured latencies, a request never becomes free
+    planner.replan_interval = 5;
+    for(int i = 0; i < 10; i++)
+        planner.execute(device);
+    assert(planner.request_cost > 0 && planner.register_cost >= 0);
+}
+
+constexpr mb::RegisterSpec testProfile[] = {
+    {"int", 40005, 2, 1., ""},
+    {"short", 40005, 1, 1., ""},
+    {"long", 40005, 4, 1., ""},
+};
+
+void test_register_bank(){
+    auto profile = mb::DeviceProfile::fromTable("TestDevice", testProfile, std::size(testProfile));
+    mb::Device device("192.168.178.176",502);
+    mb::RegisterBank bank(&device, profile);
+    bool ret = false;
+    for(size_t i = 0; i < profile->registers.size(); i++){
+        double value = bank.getValue(i, true, &ret);
+        std::cout << profile->registers[i].name << ": " << value << (ret ? "" : " (error)") << std::endl;
+    }
+}
+
+void test_lazy_connect(){
+    LoopbackServer server(1504);
+    std::vector<std::unique_ptr<mb::Device>> devices;
+    for(int i = 0; i < 4; i++)
+        devices.push_back(std::make_unique<mb::Device>("127.0.0.1", server.port, true));
+    // unroutable, connecting hangs until the timeout (or fails early without a network)
+    const auto slowConnect = std::chrono::milliseconds(3000);
+    for(int i = 0; i < 4; i++){
+        devices.push_back(std::make_unique<mb::Device>("10.255.255.1", 502, true));
+        devices.back()->connect_timeout = slowConnect;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    mb::Connector connector(8);
+    for(auto& device: devices)
+        connector.add(device.get());
+    const bool ret = connector.waitOnline(0.5, std::chrono::seconds(10));
+    const auto waited = std::chrono::steady_clock::now() - start;
+    std::cout << "online: " << connector.online() << "/" << connector.size() << " after " << std::chrono::duration_cast<std::chrono::milliseconds>(waited).count() << " ms" << std::endl;
+    assert(ret && connector.online() >= 4);
+    // half of the fleet is usable before the slow connects finish
+    assert(waited < slowConnect);
+
+    // within the retry interval requests fail without touching the missing connection
+    mb::Register<int> reg(devices.back().get(), 0);
+    bool read = true;
+    reg.getValue(true, &read);
+    assert(!read);
+}
+
+void test_bits(){
+    TestDevice testDevice("192.168.178.176",502);
+    bool ret = false;
+    bool coil = testDevice.coil->getValue(false, &ret);
+    std::cout << "coil: " << coil << (ret ? "" : " (error)") << std::endl;
+    ret = testDevice.coil->setValue(!coil);
+    std::cout << "coil toggled: " << testDevice.coil->getValue(true) << (ret ? "" : " (error)") << std::endl;
+    std::cout << "discrete input: " << testDevice.discreteInput->getValue(false, &ret) << (ret ? "" : " (error)") << std::endl;
+    std::cout << "input register: " << testDevice.intInputRegister->getValue(false, &ret) << (ret ? "" : " (error)") << std::endl;
+}
+
+void test_request_queue(){
+    mb::RequestQueue queue;
+    queue.aging = std::chrono::milliseconds(1);
+    std::mutex order_mtx;
+    std::vector<mb::Priority> order;
+    std::vector<std::thread> waiters;
+    auto enqueue = [&](mb::Priority priority){
+        const unsigned int before = queue.waiting();
+        waiters.emplace_back([&, priority](){
+            mb::RequestQueue::Ticket ticket(queue, priority);
+            std::lock_guard<std::mutex> lk(order_mtx);
+            order.push_back(priority);
+        });
+        // wait until the request is queued so the arrival order is defined
+        while(queue.waiting() == before)
+            std::this_thread::yield();
+    };
+    {
+        mb::RequestQueue::Ticket busy(queue, mb::Priority::Bulk);
+        for(int i = 0; i < 4; i++)
+            enqueue(mb::Priority::Bulk);
+        // the bulk requests age far beyond their class
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        enqueue(mb::Priority::Telemetry);
+        enqueue(mb::Priority::Control);
+    }
+    for(auto& waiter: waiters)
+        waiter.join();
+
+    assert(order.size() == 6);
+    assert(order[0] == mb::Priority::Control && "Control is granted next, even behind aged requests");
+    // aged bulk requests are promoted up to telemetry and keep their arrival order
+    for(int i = 1; i < 5; i++)
+        assert(order[i] == mb::Priority::Bulk);
+    assert(order[5] == mb::Priority::Telemetry);
+    const mb::QueueStats bulk = queue.stats(mb::Priority::Bulk);
+    assert(bulk.requests == 5 && bulk.promoted == 4);
+    std::cout << "request queue: grant order ok, " << bulk.promoted << " bulk requests promoted" << std::endl;
+}
+
+void test_shared_image(){
+    // documented layout, readers in other languages depend on it
+    static_assert(offsetof(mb::SharedImageHeader, version) == 8, "header layout");
+    static_assert(offsetof(mb::SharedImageHeader, slot_count) == 12, "header layout");
+    static_assert(offsetof(mb::SharedImageHeader, slot_size) == 16, "header layout");
+    static_assert(offsetof(mb::SharedImageHeader, used) == 20, "header layout");
+    static_assert(offsetof(mb::SharedImageHeader, device) == 24, "header layout");
+    static_assert(offsetof(mb::SharedImageSlot, addr) == 4, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, size) == 6, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, status) == 8, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, timestamp_ns) == 16, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, value) == 24, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, raw) == 32, "slot layout");
+    static_assert(offsetof(mb::SharedImageSlot, unit) == 40, "slot layout");
+
+    const std::string name = mb::SharedImage::defaultName("127.0.0.1", 1502);
+    mb::SharedImage image(name, "127.0.0.1:1502", 4);
+    assert(image.valid());
+    // a second writer must not take over the segment
+    mb::SharedImage duplicate(name, "127.0.0.1:1502", 4);
+    assert(!duplicate.valid());
+    const int slot = image.allocate(100, 4, "Wh");
+    assert(slot == 0);
+
+    // map the segment read-only like an external reader
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    assert(fd >= 0);
+    const size_t length = sizeof(mb::SharedImageHeader) + 4 * sizeof(mb::SharedImageSlot);
+    void* memory = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    assert(memory != MAP_FAILED);
+    const char* bytes = static_cast<const char*>(memory);
+    const mb::SharedImageHeader* header = static_cast<const mb::SharedImageHeader*>(memory);
+    assert(std::strcmp(header->magic, "MBIMAGE") == 0);
+    assert(header->version == mb::SharedImage::version);
+    assert(header->slot_count == 4 && header->slot_size == 64 && header->used == 1);
+    assert(std::strcmp(header->device, "127.0.0.1:1502") == 0);
+    const mb::SharedImageSlot* slots = reinterpret_cast<const mb::SharedImageSlot*>(bytes + 64);
+
+    // a writer publishes raw words that all equal the value, a torn read would mix them
+    std::atomic<bool> stop{false};
+    std::thread writer([&](){
+        for(uint16_t i = 1; !stop; i++){
+            const uint16_t raw[4] = {i, i, i, i};
+            image.publish(slot, raw, 4, i);
+        }
+    });
+    unsigned long reads = 0;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while(std::chrono::steady_clock::now() < end){
+        mb::SharedImageSlot copy;
+        mb::SharedImage::read(slots[slot], copy);
+        assert(copy.addr == 100 && copy.size == 4 && std::strcmp(copy.unit, "Wh") == 0);
+        if(copy.status == 0)
+            continue;
+        assert(copy.status == 4);
+        for(uint16_t word : copy.raw)
+            assert(word == copy.raw[0]);
+        assert(copy.value == copy.raw[0]);
+        reads++;
+    }
+    stop = true;
+    writer.join();
+    munmap(memory, length);
+    std::cout << "shared image: " << reads << " consistent reads" << std::endl;
+}
+
 int main(int argc, char **argv){
+    mb::Trace::start();
     // test_rpi_modbus();
     // test_repeated_connection();
+    test_request_queue();
+    test_shared_image();
+    test_read_planner();
+    // test_register_bank();
+    test_lazy_connect();
+    // test_bits();
     test_cache();
+    mb::Trace::stop();
     return 0;
 }